@@ -51,6 +51,13 @@ cl /nologo /std:c++20 /EHsc /Zi /Od /MDd ^
   /I "%INC_ROOT%" ^
   /Fo:build\x64\Debug\obj\ ^
   src\opus_libretro.cpp ^
+  src\opus_tasks.cpp ^
+  src\opus_jobs.cpp ^
+  src\opus_profiler.cpp ^
+  src\opus_coroutine.cpp ^
+  src\opus_gfx.cpp ^
+  src\opus_kernels.cpp ^
+  src\opus_memory.cpp ^
   /link /DLL ^
   /OUT:build\x64\Debug\opus_libretro.dll ^
   /IMPLIB:build\x64\Debug\opus_libretro.lib ^
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "opus_tasks.h"
+
+// Class FramePool
+namespace opus::tasks
+{
+    // Size-class free lists for coroutine frames, one set per thread, so no
+    // lock is taken. Blocks are carved from large chunks and recycled; a
+    // frame freed on another thread joins that thread's lists. Starting a
+    // routine does not touch the heap once the pool is warm.
+    class FramePool
+    {
+    public:
+        static constexpr size_t CLASS_SIZE = 64;
+        static constexpr size_t NUM_CLASSES = 32; // Frames up to 2 KiB are pooled
+
+        static void* Allocate(size_t size);
+        static void Free(void* block, size_t size);
+    };
+}
+
+// Class Routine
+namespace opus::tasks
+{
+    class CoroutineTask;
+
+    // Return type of CoroutineTask::Run bodies
+    class Routine
+    {
+    public:
+        struct promise_type
+        {
+            Routine get_return_object() { return Routine(Handle::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; } // Started by OnUpdate
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { throw; }
+
+            static void* operator new(size_t size) { return FramePool::Allocate(size); }
+            static void operator delete(void* block, size_t size) { FramePool::Free(block, size); }
+
+            CoroutineTask* task = nullptr;
+        };
+
+        using Handle = std::coroutine_handle<promise_type>;
+
+        // Constructor and Destructor
+        Routine() = default;
+        explicit Routine(Handle handle) : m_handle(handle) {}
+        Routine(Routine&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+        Routine& operator=(Routine&& other) noexcept;
+        ~Routine();
+
+        Routine(const Routine&) = delete;
+        Routine& operator=(const Routine&) = delete;
+
+        // State
+        bool IsValid() const { return bool(m_handle); }
+        bool IsDone() const { return !m_handle || m_handle.done(); }
+        Handle GetHandle() const { return m_handle; }
+
+    private:
+        Handle m_handle;
+    };
+}
+
+// Awaitables
+namespace opus::tasks
+{
+    struct NextTick {};         // co_await NextTick{}: resume on the task's next update
+    struct Ticks { uint32_t n; }; // co_await Ticks{n}: resume n updates later
+
+    struct TickAwaiter
+    {
+        uint32_t ticks;
+        bool await_ready() const noexcept { return ticks == 0; }
+        void await_suspend(Routine::Handle handle) noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    // Resumes on the first update that finds the flag set. Any thread may set
+    // it (a plain Task, a deferrable task or a pool job signalling that its
+    // work is done); it must outlive the wait.
+    struct CompletionAwaiter
+    {
+        const std::atomic<bool>* done;
+        bool await_ready() const noexcept { return !done || done->load(std::memory_order_acquire); }
+        void await_suspend(Routine::Handle handle) noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    inline TickAwaiter operator co_await(NextTick) noexcept { return TickAwaiter{1}; }
+    inline TickAwaiter operator co_await(Ticks ticks) noexcept { return TickAwaiter{ticks.n}; }
+    inline CompletionAwaiter WaitFor(const std::atomic<bool>& done) noexcept { return CompletionAwaiter{&done}; }
+    CompletionAwaiter operator co_await(const CoroutineTask& task) noexcept; // Until its routine finished
+}
+
+// Class CoroutineTask
+namespace opus::tasks
+{
+    // A Task whose behaviour is one coroutine spanning many ticks instead of a
+    // hand-written state machine. Run() is started on the first update; each
+    // co_await suspends until the condition holds on a later update.
+    class CoroutineTask : public Task
+    {
+    public:
+        // Constructor and Destructor
+        CoroutineTask();
+        CoroutineTask(uint32_t modulo, uint32_t offset, bool enable, bool internal);
+        ~CoroutineTask() override = default;
+
+        // Control
+        void Restart(); // Drops the current routine; Run() starts again next update
+
+        // State
+        bool IsFinished() const;
+
+    protected:
+        virtual Routine Run() = 0;
+        void OnUpdate(uint64_t count) override;
+
+        uint64_t CurrentCount() const; // Count of the update that resumed the routine
+
+    private:
+        friend struct TickAwaiter;
+        friend struct CompletionAwaiter;
+        friend CompletionAwaiter operator co_await(const CoroutineTask& task) noexcept;
+
+        Routine m_routine;
+        uint32_t m_waitTicks = 0; // Updates left before resuming
+        const std::atomic<bool>* m_waitFor = nullptr; // Resume once it is set
+        std::atomic<bool> m_finished{false}; // The routine ran to completion
+        uint64_t m_currentCount = 0;
+    };
+}
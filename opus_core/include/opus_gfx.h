@@ -1,41 +1,60 @@
 #pragma once
 #include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <algorithm>
 
+#include "opus_pixel.h"
 #include "opus_tasks.h"
 
 // Class Color
 namespace opus::gfx
 {
+    // 0xXXRRGGBB. Header-only and constexpr so per-pixel use inlines; see
+    // opus_pixel.h for packing into surface formats.
     class Color
     {
     public:
         // Constructor and Destructor
-        Color();
-        Color(uint32_t xrgb);
-        ~Color();
+        constexpr Color() : m_color(0) {}
+        constexpr Color(uint32_t xrgb) : m_color(xrgb) {}
 
         // Getters
-        uint32_t GetXRGB() const;
-        uint32_t GetRGB() const;
-        uint8_t GetX() const;
-        uint8_t GetR() const;
-        uint8_t GetG() const;
-        uint8_t GetB() const;
+        constexpr uint32_t GetXRGB() const { return m_color; }
+        constexpr uint32_t GetRGB() const { return m_color & 0x00FFFFFFu; }
+        constexpr uint8_t GetX() const { return uint8_t((m_color >> 24) & 0xFFu); }
+        constexpr uint8_t GetR() const { return uint8_t((m_color >> 16) & 0xFFu); }
+        constexpr uint8_t GetG() const { return uint8_t((m_color >> 8) & 0xFFu); }
+        constexpr uint8_t GetB() const { return uint8_t((m_color >> 0) & 0xFFu); }
 
         // Setters
-        void SetXRGB(uint8_t x, uint8_t r, uint8_t g, uint8_t b);
-        void SetRGB(uint8_t r, uint8_t g, uint8_t b);
-        void SetX(uint8_t x);
-        void SetR(uint8_t r);
-        void SetG(uint8_t g);
-        void SetB(uint8_t b);
+        constexpr void SetXRGB(uint8_t x, uint8_t r, uint8_t g, uint8_t b)
+        {
+            m_color = (uint32_t(x) << 24) | (uint32_t(r) << 16) | (uint32_t(g) << 8) | (uint32_t(b) << 0);
+        }
+        constexpr void SetRGB(uint8_t r, uint8_t g, uint8_t b)
+        {
+            m_color = (m_color & 0xFF000000u) | (uint32_t(r) << 16) | (uint32_t(g) << 8) | (uint32_t(b) << 0);
+        }
+        constexpr void SetX(uint8_t x) { m_color = (m_color & 0x00FFFFFFu) | (uint32_t(x) << 24); }
+        constexpr void SetR(uint8_t r) { m_color = (m_color & 0xFF00FFFFu) | (uint32_t(r) << 16); }
+        constexpr void SetG(uint8_t g) { m_color = (m_color & 0xFFFF00FFu) | (uint32_t(g) << 8); }
+        constexpr void SetB(uint8_t b) { m_color = (m_color & 0xFFFFFF00u) | (uint32_t(b) << 0); }
 
         // Helpers
-        static Color FromRGB(uint8_t r, uint8_t g, uint8_t b);
-        static Color FromXRGB(uint8_t x, uint8_t r, uint8_t g, uint8_t b);
+        static constexpr Color FromRGB(uint8_t r, uint8_t g, uint8_t b) { return FromXRGB(0, r, g, b); }
+        static constexpr Color FromXRGB(uint8_t x, uint8_t r, uint8_t g, uint8_t b)
+        {
+            Color c;
+            c.SetXRGB(x, r, g, b);
+            return c;
+        }
+
+        template <typename Format>
+        constexpr typename Format::Storage Pack() const { return Format::FromXRGB(m_color); } // e.g. Pack<pixel::RGB565>()
 
     private:
         uint32_t m_color;
@@ -45,51 +64,448 @@ namespace opus::gfx
 // Class Palette
 namespace opus::gfx
 {
+    // Colours plus cached RGB565 and XRGB8888 lookup tables. Changes only
+    // mark entries stale; the next table read converts just those entries,
+    // so cycling or fading a few colours costs a few conversions.
     class Palette
     {
     public:
-        static constexpr uint8_t MAX_COLORS = 256;
+        static constexpr uint16_t MAX_COLORS = 256;
 
         // Constructor and Destructor
         Palette();
         ~Palette();
 
         // Getters
-        uint8_t GetNumColor();
-        const Color& GetColor(uint8_t index) const;
-        Color& GetColor(uint8_t index);
+        uint16_t GetNumColor() const;
+        uint64_t GetVersion() const; // Bumped by every change
+        const Color& GetColor(uint8_t index) const; // Change entries with SetColor()
+
+        // Lookup tables, MAX_COLORS entries (RGB565 has a spare zero entry
+        // so 32-bit gathers may read past the last one). Update thread only.
+        const uint16_t* GetRGB565Table() const;
+        const uint32_t* GetXRGB8888Table() const;
 
         // Setters
         void SetColor(uint8_t index, const Color& color);
+        void Cycle(uint8_t first, uint8_t last, int32_t steps = 1); // Rotates [first, last] by steps
 
     private:
-        uint8_t m_numColors; // 0..255
+        void MarkStale(uint8_t index);
+        void Refresh() const;
+
+        uint16_t m_numColors; // 0..256
+        uint64_t m_version = 0;
         std::array<Color, MAX_COLORS> m_palette;
+
+        // Lookup cache
+        mutable std::array<uint64_t, MAX_COLORS / 64> m_stale; // One bit per entry
+        mutable bool m_anyStale = true;
+        alignas(32) mutable std::array<uint16_t, MAX_COLORS + 2> m_rgb565{};
+        alignas(32) mutable std::array<uint32_t, MAX_COLORS> m_xrgb8888{};
+    };
+}
+
+// Struct Rect
+namespace opus::gfx
+{
+    struct Rect
+    {
+        int32_t x = 0;
+        int32_t y = 0;
+        int32_t w = 0;
+        int32_t h = 0;
+
+        constexpr int32_t Right() const { return x + w; }   // Exclusive
+        constexpr int32_t Bottom() const { return y + h; }  // Exclusive
+        constexpr bool IsEmpty() const { return w <= 0 || h <= 0; }
+        constexpr int64_t Area() const { return IsEmpty() ? 0 : int64_t(w) * h; }
+        constexpr bool Intersects(const Rect& other) const { return !Intersect(other).IsEmpty(); }
+
+        constexpr Rect Intersect(const Rect& other) const
+        {
+            const int32_t left = std::max(x, other.x);
+            const int32_t top = std::max(y, other.y);
+            const int32_t right = std::min(Right(), other.Right());
+            const int32_t bottom = std::min(Bottom(), other.Bottom());
+            return Rect{left, top, std::max(0, right - left), std::max(0, bottom - top)};
+        }
+
+        constexpr Rect Union(const Rect& other) const // Bounding box; empty rects are ignored
+        {
+            if (IsEmpty())
+                return other;
+            if (other.IsEmpty())
+                return *this;
+
+            const int32_t left = std::min(x, other.x);
+            const int32_t top = std::min(y, other.y);
+            return Rect{left, top, std::max(Right(), other.Right()) - left, std::max(Bottom(), other.Bottom()) - top};
+        }
     };
 }
 
 // Class Surface
 namespace opus::gfx
 {
-    class Surface;
+    // Pixel buffer with an explicit pitch. Owned surfaces start every row on a
+    // 64-byte boundary. Copies and sub-surfaces are views that share the same
+    // memory (and keep it alive); nothing is copied. Views also share a
+    // generation counter that writers bump, so consumers can tell whether the
+    // pixels changed since they last looked.
+    class Surface
+    {
+    public:
+        static constexpr size_t ROW_ALIGNMENT = 64;
+
+        // Constructor and Destructor
+        Surface();
+        Surface(uint32_t width, uint32_t height, PixelFormat format); // Allocates
+        ~Surface();
+
+        // Views
+        static Surface Wrap(void* data, uint32_t width, uint32_t height, size_t pitch, PixelFormat format);
+        Surface SubSurface(const Rect& rect) const; // Clipped to the surface
+
+        // Getters
+        bool IsValid() const;
+        uint32_t GetWidth() const;
+        uint32_t GetHeight() const;
+        size_t GetPitch() const; // Bytes between rows
+        PixelFormat GetFormat() const;
+        Rect GetBounds() const;
+        const Rect& GetClip() const; // Region drawing may touch; the bounds by default
+        uint8_t* GetData() const;
+        uint8_t* GetRow(uint32_t y) const;
+        uint64_t GetGeneration() const;
+
+        template <typename T>
+        T* GetRowAs(uint32_t y) const { return reinterpret_cast<T*>(GetRow(y)); }
+
+        // Setters
+        void SetClip(const Rect& clip); // Clamped to the bounds; per view, not shared
+
+        // Helpers
+        uint32_t Pack(const Color& color) const; // Native format; Indexed8 takes the index from the low byte
+        void Fill(const Color& color); // Fills the clip rect
+        void Touch(); // Call after writing pixels directly
+
+    private:
+        struct Buffer;
+
+        std::shared_ptr<Buffer> m_buffer; // Pixels (unless wrapped) and generation
+        uint8_t* m_data = nullptr;
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        size_t m_pitch = 0;
+        PixelFormat m_format = PixelFormat::RGB565;
+        Rect m_clip;
+    };
+}
+
+// Blit Options
+namespace opus::gfx
+{
+    enum class BlendMode : uint8_t
+    {
+        Opaque,   // Copy
+        ColorKey, // Source pixels equal to the key are skipped
+        Alpha,    // XRGB8888 source, the top byte is alpha (0 transparent, 255 opaque)
+    };
+
+    struct BlitOptions
+    {
+        BlendMode mode = BlendMode::Opaque;
+        uint32_t key = 0; // ColorKey only; packed in the source format
+        bool flipX = false;
+        bool flipY = false;
+    };
+}
+
+// Struct Font
+namespace opus::gfx
+{
+    // Fixed-cell bitmap font: glyphs for ' ' to '~' in rows of 16 cells,
+    // drawn colour keyed with the sheet's own colours
+    struct Font
+    {
+        static constexpr uint32_t GLYPHS_PER_ROW = 16;
+
+        Surface glyphs;
+        uint32_t cellWidth = 8;
+        uint32_t cellHeight = 8;
+        uint32_t key = 0; // Transparent colour, packed in the glyph format
+    };
+}
+
+// Class DisplayList
+namespace opus::gfx
+{
+    class Drawable;
+
+    struct DrawCommand
+    {
+        enum class Type : uint8_t
+        {
+            Fill,     // bounds with color
+            Blit,     // source of the image at (x, y)
+            Line,     // (x, y) to (source.x, source.y) in color
+            Text,     // length characters at (x, y)
+            Drawable, // Draw() of a drawable that does not record
+        };
+
+        Type type = Type::Fill;
+        uint16_t layer = 0; // Replay order after Sort(); list order within a layer
+        Color color;
+        Rect bounds; // Target area the command may write
+        Rect source;
+        int32_t x = 0;
+        int32_t y = 0;
+        BlitOptions options; // Blit and Text
+        const void* object = nullptr; // Surface, Font or Drawable
+        uint32_t text = 0; // Offset into the list's characters
+        uint32_t length = 0;
+    };
+
+    // Retained draw commands. Drawables record into a list, which can then
+    // be sorted, culled and merged, and replayed into one or many views of
+    // a target. Clearing keeps the storage, so a list reused every frame
+    // stops allocating once it has grown to the busiest frame. Referenced
+    // surfaces, fonts and drawables must outlive the replay.
+    class DisplayList
+    {
+    public:
+        // Constructor and Destructor
+        DisplayList() = default;
+        ~DisplayList();
+
+        // Recording
+        void Clear();
+        void SetLayer(uint16_t layer); // For the commands recorded after this
+        void Fill(const Rect& rect, const Color& color);
+        void Blit(const Surface& image, const Rect& frame, int32_t x, int32_t y, const BlitOptions& options);
+        void Line(int32_t x0, int32_t y0, int32_t x1, int32_t y1, const Color& color);
+        void Text(const Font& font, int32_t x, int32_t y, const char* text, size_t length);
+        void Draw(Drawable& drawable); // Replays as a plain Draw() call
+        void Append(const DisplayList& other); // Commands keep their own layers
+
+        // Optimization
+        void Sort(); // By layer, stable
+        void Cull(const Rect& view); // Drops what the view cannot show; clips the rest's bounds
+        void Merge(); // Joins adjoining fills, drops whatever a later fill hides
+
+        // Replay
+        void Replay(Surface& target) const; // Clipped to target.GetClip()
+        void Replay(const Surface& target, opus::jobs::JobPool& pool, uint32_t bands) const; // Banded
+
+        // Getters
+        const std::vector<DrawCommand>& GetCommands() const;
+        Rect GetBounds() const; // Union of every command's bounds
+        bool IsEmpty() const;
+
+    private:
+        void Push(const DrawCommand& command);
+        void Execute(const DrawCommand& command, Surface& view) const;
+
+        std::vector<DrawCommand> m_commands;
+        std::vector<DrawCommand> m_scratch; // Sort buffer
+        std::vector<char> m_text;
+        uint16_t m_layer = 0;
+    };
 }
 
 // Class Drawable
 namespace opus::gfx
 {
+    class DrawableTask;
+
     class Drawable
     {
     public:
-        // Constructor and Destructor
+        // Constructor and Destructor. Destroy a drawable on its parent's update
+        // thread, or off it once GetParent() returned nullptr after
+        // RemoveDrawable; the destructor then leaves the task alone.
         Drawable() = default;
-        virtual ~Drawable() = default;
+        virtual ~Drawable();
+
+        bool IsVisible() const;
+        bool IsDrawable() const;
+        bool IsDirty() const;
+        DrawableTask* GetParent() const; // Set by AddDrawable; nullptr once a Remove was applied
+
+        // Setters may run on any thread, tasks on a JobPool included, but not
+        // while the parent task is updating: it reads the state they write.
+        void SetVisible(bool visible);
+        void MarkDirty(); // Appearance or bounds changed; redraw (and refile) on the next update
+
+        // Draw order within a task: higher layers draw over lower ones, and
+        // equal layers keep the order they were added in. Changing the layer
+        // is cheap; the task re-sorts on its next pass.
+        void SetLayer(uint16_t layer);
+        uint16_t GetLayer() const;
 
-        bool IsVisible();
-        bool IsDrawable();
+        // Area Draw() may write, in target coordinates. Tasks cull by it, and
+        // read it again only after MarkDirty(). The default covers any target,
+        // so such drawables are redrawn whenever a region is dirty.
+        virtual Rect GetBounds() const;
+
+        // Called on the update thread before a pass that may draw this, so
+        // Draw() can stay read-only (banded passes call it from workers)
+        virtual void Prepare(const Surface& target);
+
+        // Must stay inside target.GetClip(); the task redraws only dirty regions
         virtual void Draw(Surface& target) = 0;
+
+        // Records what Draw() would do instead of doing it. False for
+        // drawables that only draw immediately; they replay as Draw() calls.
+        virtual bool Record(DisplayList& list);
     private:
+        friend class DrawableTask;
+
         bool m_visible = true;
-        bool m_renderable;
+        bool m_renderable = true;
+        std::atomic<bool> m_dirty{true}; // New drawables have never been drawn
+        Rect m_drawnBounds; // Bounds as of the last pass, unclipped; empty while hidden (update thread only)
+        std::atomic<DrawableTask*> m_parent{nullptr}; // Task this drawable was added to
+        std::atomic<bool> m_removing{false}; // A queued Remove that a later Add may still cancel
+        std::atomic<bool> m_queued{false}; // On the parent's marked list
+        Drawable* m_nextMarked = nullptr; // Link in that list
+        bool m_listed = false; // In the parent's change list (update thread only)
+        bool m_attached = false; // Present in the parent's list (update thread only)
+        uint16_t m_layer = 0;
+        uint32_t m_index = 0; // Position in the parent's list (update thread only)
+        uint32_t m_visited = 0; // Parent's last pass that gathered this
+    };
+}
+
+// Class Sprite
+namespace opus::gfx
+{
+    // An image, or one frame of a sheet, drawn at a position. The image is a
+    // view and is not copied; call MarkDirty() after editing its pixels.
+    class Sprite : public Drawable
+    {
+    public:
+        // Constructor and Destructor
+        Sprite() = default;
+        explicit Sprite(const Surface& image);
+        ~Sprite() override;
+
+        // Getters
+        const Surface& GetImage() const;
+        const Rect& GetFrame() const;
+        int32_t GetX() const;
+        int32_t GetY() const;
+        const BlitOptions& GetOptions() const;
+
+        // Setters
+        void SetImage(const Surface& image); // Frame becomes the whole image
+        void SetFrame(const Rect& frame); // Part of the image to draw; clipped to it
+        void SetPosition(int32_t x, int32_t y);
+        void SetBlendMode(BlendMode mode);
+        void SetColorKey(const Color& key); // Packed in the image format (set the image first); an index for Indexed8
+        void SetFlip(bool flipX, bool flipY);
+
+        Rect GetBounds() const override;
+        void Draw(Surface& target) override;
+        bool Record(DisplayList& list) override;
+
+    private:
+        Surface m_image;
+        Rect m_frame;
+        int32_t m_x = 0;
+        int32_t m_y = 0;
+        BlitOptions m_options;
+    };
+}
+
+// Class TileMapLayer
+namespace opus::gfx
+{
+    // A grid of tiles from a tileset, scrolled inside a viewport. Tiles are
+    // converted to the target format once and cached; drawing copies one
+    // run per visible tile row, so a full-screen layer costs about one
+    // framebuffer of writes whatever the scroll.
+    class TileMapLayer : public Drawable
+    {
+    public:
+        static constexpr uint16_t EMPTY_TILE = 0xFFFF; // Nothing drawn; lower layers show through
+
+        // Constructor and Destructor
+        TileMapLayer() = default;
+        ~TileMapLayer() override;
+
+        // Getters
+        const Surface& GetTileset() const;
+        uint32_t GetTileWidth() const;
+        uint32_t GetTileHeight() const;
+        uint32_t GetTileCount() const; // Tiles in the tileset, numbered row-major
+        uint32_t GetColumns() const;
+        uint32_t GetRows() const;
+        uint16_t GetTile(uint32_t column, uint32_t row) const; // EMPTY_TILE outside the map
+        int32_t GetScrollX() const;
+        int32_t GetScrollY() const;
+        bool IsWrapping() const;
+
+        // Setters
+        // The tileset may be any direct-colour format, or Indexed8 for Indexed8
+        // targets. After editing its pixels, Touch() it and MarkDirty() the layer.
+        void SetTileset(const Surface& tileset, uint32_t tileWidth, uint32_t tileHeight);
+        void SetMapSize(uint32_t columns, uint32_t rows); // Every tile becomes EMPTY_TILE
+        void SetTile(uint32_t column, uint32_t row, uint16_t tile);
+        void SetScroll(int32_t x, int32_t y); // Map pixel at the viewport's top-left
+        void SetViewport(const Rect& viewport); // Target area covered; empty for the whole target
+        void SetWrapping(bool wrap); // Repeat the map instead of leaving the outside undrawn
+
+        Rect GetBounds() const override;
+        void Prepare(const Surface& target) override; // Builds the tile cache
+        void Draw(Surface& target) override;
+
+    private:
+        bool UpdateCache(PixelFormat format);
+        const uint8_t* GetCachedRow(uint16_t tile, uint32_t y) const;
+
+        Surface m_tileset;
+        uint32_t m_tileWidth = 0;
+        uint32_t m_tileHeight = 0;
+        uint32_t m_tileCount = 0;
+        uint32_t m_columns = 0;
+        uint32_t m_rows = 0;
+        std::vector<uint16_t> m_tiles; // Row-major
+        int32_t m_scrollX = 0;
+        int32_t m_scrollY = 0;
+        Rect m_viewport;
+        bool m_wrap = false;
+
+        // Tile cache: one row per tile in the last target's format
+        Surface m_cache;
+        uint64_t m_cacheGeneration = 0; // Tileset generation the cache was built from
+        bool m_cacheValid = false;
+    };
+}
+
+// Class StaticLayer
+namespace opus::gfx
+{
+    // Commands recorded once and kept: recording appends them instead of
+    // re-recording. Call MarkDirty() after editing the list.
+    class StaticLayer : public Drawable
+    {
+    public:
+        // Constructor and Destructor
+        StaticLayer() = default;
+        ~StaticLayer() override;
+
+        // Getters
+        DisplayList& GetList();
+        const DisplayList& GetList() const;
+
+        Rect GetBounds() const override;
+        void Draw(Surface& target) override;
+        bool Record(DisplayList& list) override;
+
+    private:
+        DisplayList m_list;
     };
 }
 
@@ -99,15 +515,101 @@ namespace opus::gfx
     class DrawableTask : public opus::tasks::Task
     {
     public:
+        static constexpr size_t MAX_DIRTY_RECTS = 8; // Beyond this, nearby regions are merged
+        static constexpr uint32_t MIN_BAND_ROWS = 8;
+        static constexpr int64_t MIN_BANDED_PIXELS = 16384; // Smaller updates stay on the update thread
+
+        // Culling. Drawables are filed by their bounds in a uniform grid when
+        // added or marked dirty, and a pass visits only the cells its dirty
+        // regions cover, so unchanged off-screen drawables cost nothing.
+        static constexpr int32_t CELL_SHIFT = 6; // 64-pixel cells
+        static constexpr size_t GRID_BUCKETS = 4096; // Cells hash into these; a power of two
+        static constexpr int64_t MAX_FILED_CELLS = 64; // Larger drawables are checked every pass
+
+        ~DrawableTask() override;
+
+        // Queued from any thread; applied at the top of the next update, in
+        // order. Adding a drawable whose Remove is still queued cancels it.
         bool AddDrawable(Drawable& drawable);
         bool RemoveDrawable(Drawable& drawable);
         bool Clear();
+        void ApplyPending(); // Update thread only
+
+        // Render Target
+        void SetTarget(const Surface& target); // Update thread only
+        const Surface& GetTarget() const;
+        void SetClearColor(const Color& color); // Target is cleared before each redraw
+        void Invalidate(); // Redraw everything on the next update
+
+        // Banded Rendering. With a pool, the target is split into horizontal
+        // bands that workers draw at once, each through its own view clipped
+        // to its band, in layer order. Draw() must then be safe to call from
+        // several threads and must not add, remove or destroy drawables.
+        void SetJobPool(opus::jobs::JobPool* pool); // nullptr = update thread only
+        void SetBandCount(uint32_t bands); // 0 = a few per thread
+        uint32_t GetBandCount() const; // Bands a large update is split into
+
+        // Recorded Rendering. Each pass records the drawables into a display
+        // list in layer order, culls and merges it, then replays it in place
+        // of the Draw() calls (on bands too, with a pool). Commands carry
+        // their drawable's layer. Draw() must not destroy drawables, since
+        // the list may still name them.
+        void SetRecording(bool recording);
+        const DisplayList& GetDisplayList() const; // Recorded by the last pass
+
+        // State
+        bool IsDirty() const; // Next update would change the target's pixels
+        const std::vector<Rect>& GetDirtyRects() const; // Regions redrawn by the last update
 
     protected:
         void OnInitialize() override {}
         void OnUpdate(uint64_t count) override;
 
     private:
-        std::vector<Drawable*> m_drawables;
-    }
-}
\ No newline at end of file
+        friend class Drawable;
+
+        struct Command
+        {
+            enum class Type : uint8_t { Add, Remove, Clear };
+            Type type;
+            Drawable* drawable;
+        };
+
+        void Attach(Drawable& drawable);
+        void Detach(Drawable& drawable);
+        void Forget(Drawable& drawable); // A drawable is being destroyed
+        void TakeMarked(); // Marked list into m_changed
+        void Expose(const Rect& rect); // Region must be redrawn
+        void CollectDirtyRects();
+        void File(Drawable& drawable); // Into the grid, by m_drawnBounds
+        void Unfile(Drawable& drawable);
+        void Gather(); // Drawables reaching the dirty regions, by layer
+        void DrawRegion(Surface& view, const Rect& region, const std::vector<uint32_t>& drawables);
+
+        opus::jobs::CommandQueue<Command> m_commands;
+        std::atomic<uint32_t> m_clears{0}; // Clear commands not yet applied
+        std::atomic<Drawable*> m_marked{nullptr}; // Marked dirty from any thread, not yet in m_changed
+        std::vector<Drawable*> m_drawables; // In the order they were added
+        std::vector<Drawable*> m_changed; // Marked dirty since the last pass
+        std::vector<std::vector<Drawable*>> m_grid; // Spatial hash of m_drawnBounds
+        std::vector<Drawable*> m_large; // Too large for the grid
+        std::vector<uint32_t> m_order; // Indices into m_drawables gathered this pass, by layer
+        std::vector<uint32_t> m_orderScratch;
+        Surface m_target;
+        std::vector<Rect> m_exposed; // From removed drawables, since the last draw
+        std::vector<Rect> m_dirtyRects;
+        std::vector<Rect> m_bounds; // Per m_order entry, clipped to the target; empty if not drawn
+        std::vector<std::vector<uint32_t>> m_bands; // m_order positions reaching each band
+        uint64_t m_drawnGeneration = 0; // Target generation after our last draw
+        Color m_clearColor;
+        opus::jobs::JobPool* m_pool = nullptr;
+        uint32_t m_bandCount = 0;
+        uint32_t m_pass = 0;
+        DisplayList m_list;
+        bool m_recording = false;
+        bool m_clear = false;
+        bool m_dirty = true; // List or target changed since the last draw
+        bool m_drawing = false; // Inside OnUpdate: destroyed drawables leave a hole in each list
+        bool m_hasHoles = false;
+    };
+}
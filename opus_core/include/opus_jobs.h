@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "opus_memory.h"
+
+// Class JobPool
+namespace opus::jobs
+{
+    // Fixed-size work-stealing thread pool. Every worker owns a bounded
+    // lock-free ring: any thread pushes, the owner takes from the front, and
+    // workers that run dry steal from the front of the others. Nothing is
+    // allocated per job; a job that finds its ring full runs on the caller.
+    class JobPool
+    {
+    public:
+        using Kernel = void (*)(void* context, uint32_t index);
+
+        // Constructor and Destructor
+        explicit JobPool(uint32_t numWorkers); // 0 = run everything on the caller
+        ~JobPool();
+
+        JobPool(const JobPool&) = delete;
+        JobPool& operator=(const JobPool&) = delete;
+
+        // Control
+        // Calls kernel(context, i) for every i in [0, count) and returns once all
+        // of them finished. The calling thread executes jobs while it waits.
+        void Run(uint32_t count, Kernel kernel, void* context);
+
+        template <typename Fn>
+        void ParallelFor(uint32_t count, Fn&& fn)
+        {
+            using FnType = std::remove_reference_t<Fn>;
+            Run(count,
+                [](void* context, uint32_t index) { (*static_cast<FnType*>(context))(index); },
+                const_cast<void*>(static_cast<const void*>(&fn)));
+        }
+
+        // Frame boundary: each worker resets its opus::memory::GetFrameArena()
+        // before the next job it takes, when no job of its own is running
+        void NextFrame();
+
+        // State
+        uint32_t NumWorkers() const;
+
+        // Helpers
+        static uint32_t DefaultWorkerCount(); // hardware threads minus the caller
+
+    private:
+        struct Batch
+        {
+            Kernel kernel;
+            void* context;
+            std::atomic<uint32_t> pending;
+        };
+
+        struct Job
+        {
+            Batch* batch;
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        // Bounded multi-producer, multi-consumer ring (Vyukov). A cell's
+        // sequence says whose turn it is: equal to a push position when the
+        // cell is free, one past it once the job is in.
+        struct Queue
+        {
+            static constexpr uint32_t CAPACITY = 256; // Power of two
+
+            struct Cell
+            {
+                std::atomic<uint32_t> sequence;
+                Job job;
+            };
+
+            Queue();
+
+            std::array<Cell, CAPACITY> cells;
+            alignas(64) std::atomic<uint32_t> pushPos{0};
+            alignas(64) std::atomic<uint32_t> takePos{0};
+        };
+
+        bool Push(uint32_t queue, const Job& job); // false if the ring is full
+        bool Take(Queue& q, Job& job);
+        bool Pop(uint32_t queue, Job& job);
+        bool Steal(uint32_t thief, Job& job);
+        void Execute(const Job& job);
+        void WorkerLoop(uint32_t worker);
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread> m_workers;
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wake;
+        std::atomic<uint32_t> m_queued{0};
+        std::atomic<uint32_t> m_nextQueue{0};
+        std::atomic<uint64_t> m_frame{0}; // Bumped by NextFrame
+        bool m_stop = false;
+    };
+}
+
+// Class CommandQueue
+namespace opus::jobs
+{
+    // Multi-producer, single-consumer queue. Push is lock-free from any thread;
+    // the owner drains everything, oldest first, at a point of its choosing.
+    // Nodes are carved from chunks the queue keeps and are recycled through a
+    // free list, so pushing takes nothing from the heap once the queue has
+    // held its largest backlog. Nodes are named by index, which lets the free
+    // list carry an ABA tag next to the head.
+    template <typename T>
+    class CommandQueue
+    {
+    public:
+        // Constructor and Destructor
+        CommandQueue() = default;
+        ~CommandQueue()
+        {
+            Drain([](T&&) {});
+            for (uint32_t c = 0; c < MAX_CHUNKS; ++c)
+            {
+                if (Node* chunk = m_chunks[c].load(std::memory_order_relaxed))
+                    opus::memory::FreeBlock(chunk, sizeof(Node) * ChunkSize(c), alignof(Node));
+            }
+        }
+
+        CommandQueue(const CommandQueue&) = delete;
+        CommandQueue& operator=(const CommandQueue&) = delete;
+
+        // Control
+        void Push(T value)
+        {
+            const uint32_t index = Acquire();
+            Node& node = At(index);
+            ::new (static_cast<void*>(node.storage)) T(std::move(value));
+
+            uint32_t head = m_head.load(std::memory_order_relaxed);
+            do
+            {
+                node.next.store(head, std::memory_order_relaxed);
+            } while (!m_head.compare_exchange_weak(head, index, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        template <typename Fn>
+        void Drain(Fn&& fn)
+        {
+            // Take the whole stack at once (no ABA), then reverse it into FIFO order
+            uint32_t index = m_head.exchange(NIL, std::memory_order_acquire);
+            uint32_t fifo = NIL;
+            while (index != NIL)
+            {
+                Node& node = At(index);
+                const uint32_t next = node.next.load(std::memory_order_relaxed);
+                node.next.store(fifo, std::memory_order_relaxed);
+                fifo = index;
+                index = next;
+            }
+
+            while (fifo != NIL)
+            {
+                Node& node = At(fifo);
+                const uint32_t next = node.next.load(std::memory_order_relaxed);
+                T* value = std::launder(reinterpret_cast<T*>(node.storage));
+                fn(std::move(*value));
+                value->~T();
+                Release(fifo);
+                fifo = next;
+            }
+        }
+
+        // State
+        bool IsEmpty() const { return m_head.load(std::memory_order_acquire) == NIL; }
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX;
+        static constexpr uint32_t FIRST_CHUNK_SHIFT = 6; // 64 nodes, doubling per chunk
+        static constexpr uint32_t MAX_CHUNKS = 26; // Indices stay below NIL
+
+        struct Node
+        {
+            alignas(T) std::byte storage[sizeof(T)];
+            std::atomic<uint32_t> next;
+        };
+
+        static uint32_t ChunkSize(uint32_t chunk) { return 1u << (FIRST_CHUNK_SHIFT + chunk); }
+        static uint32_t ChunkBase(uint32_t chunk) { return ((1u << chunk) - 1) << FIRST_CHUNK_SHIFT; }
+
+        Node& At(uint32_t index) const
+        {
+            const uint32_t chunk = uint32_t(std::bit_width((index >> FIRST_CHUNK_SHIFT) + 1) - 1);
+            return m_chunks[chunk].load(std::memory_order_acquire)[index - ChunkBase(chunk)];
+        }
+
+        // Free list head: index in the low half, a tag bumped by every change above it
+        static uint64_t Tagged(uint64_t head, uint32_t index) { return ((head >> 32) + 1) << 32 | index; }
+
+        uint32_t Acquire()
+        {
+            uint64_t head = m_free.load(std::memory_order_acquire);
+            while (uint32_t(head) != NIL)
+            {
+                const uint32_t next = At(uint32_t(head)).next.load(std::memory_order_relaxed);
+                if (m_free.compare_exchange_weak(head, Tagged(head, next), std::memory_order_acquire, std::memory_order_acquire))
+                    return uint32_t(head);
+            }
+            return Grow();
+        }
+
+        void Release(uint32_t index)
+        {
+            ReleaseChain(index, index);
+        }
+
+        void ReleaseChain(uint32_t first, uint32_t last)
+        {
+            uint64_t head = m_free.load(std::memory_order_relaxed);
+            do
+            {
+                At(last).next.store(uint32_t(head), std::memory_order_relaxed);
+            } while (!m_free.compare_exchange_weak(head, Tagged(head, first), std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        uint32_t Grow()
+        {
+            // Rare, so a lock; the new chunk's first node is ours, the rest are freed
+            std::lock_guard<std::mutex> lock(m_growMutex);
+            const uint32_t chunk = m_numChunks;
+            if (chunk == MAX_CHUNKS)
+                throw std::bad_alloc();
+
+            const uint32_t size = ChunkSize(chunk);
+            Node* nodes = static_cast<Node*>(opus::memory::AllocateBlock(sizeof(Node) * size, alignof(Node)));
+            for (uint32_t i = 0; i < size; ++i)
+                ::new (static_cast<void*>(&nodes[i].next)) std::atomic<uint32_t>(i + 1 < size ? ChunkBase(chunk) + i + 1 : NIL);
+
+            m_chunks[chunk].store(nodes, std::memory_order_release);
+            ++m_numChunks;
+
+            const uint32_t first = ChunkBase(chunk);
+            if (size > 1)
+                ReleaseChain(first + 1, first + size - 1);
+            return first;
+        }
+
+        std::atomic<uint32_t> m_head{NIL}; // Pushed, not yet drained; newest first
+        std::atomic<uint64_t> m_free{NIL};
+        std::array<std::atomic<Node*>, MAX_CHUNKS> m_chunks{};
+        uint32_t m_numChunks = 0;
+        std::mutex m_growMutex;
+    };
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "opus_gfx.h"
+
+// Surface Kernels
+namespace opus::gfx::kernels
+{
+    // Instruction sets the kernels can be built on. The best one the CPU
+    // supports is picked on first use; scalar code is always available.
+    enum class Isa : uint8_t
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    // Dispatch
+    Isa GetIsa();
+    bool SetIsa(Isa isa); // False if the CPU lacks it. Quiet points only (benchmarks, testing)
+    bool IsSupported(Isa isa);
+    const char* IsaName(Isa isa);
+
+    // Row Primitives
+    void FillRow(uint8_t* dst, uint32_t count, uint32_t packed, PixelFormat format);
+
+    // Surface Operations. Everything is clipped to target.GetClip() and takes
+    // colours packed in the target's format (Surface::Pack; indices for
+    // Indexed8). The handle is not modified; callers Touch() the surface
+    // when they are done.
+    void FillRect(const Surface& target, const Rect& rect, uint32_t packed);
+
+    // One-pixel line from (x0, y0) to (x1, y1), both ends included
+    void DrawLine(const Surface& target, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t packed);
+
+    // Two-colour checker of tileW x tileH tiles anchored at the surface
+    // origin; the tile at (0, 0) gets packedA.
+    void FillPattern(const Surface& target, const Rect& rect, uint32_t packedA, uint32_t packedB,
+                     uint32_t tileW, uint32_t tileH);
+
+    // Copies row srcY's span [rect.x, rect.Right()) into every other row of rect
+    void ReplicateRow(const Surface& target, int32_t srcY, const Rect& rect);
+
+    // Palette Expansion. Converts an Indexed8 src into dst's clip rect (same
+    // coordinates) through palette. dst must be RGB565 or XRGB8888.
+    bool Expand(const Surface& src, const Surface& dst, const Palette& palette);
+
+    // Format Conversion. Copies src into dst's clip rect (same coordinates)
+    // between any two direct-colour formats. False for Indexed8.
+    bool Convert(const Surface& src, const Surface& dst);
+
+    // Sprite Blits. Draws srcRect of src (clipped to src) with its top-left at
+    // (x, y), clipped to target.GetClip(). Opaque and ColorKey need matching
+    // formats; Alpha needs an XRGB8888 source and a direct-colour target.
+    // False when the formats don't suit the mode.
+    bool Blit(const Surface& target, int32_t x, int32_t y, const Surface& src, const Rect& srcRect,
+              const BlitOptions& options);
+}
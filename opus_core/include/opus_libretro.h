@@ -1,5 +1,13 @@
 #include <cstdint>
 #include <cstring>
+#include <memory>
+
+#include "opus_gfx.h"
+#include "opus_jobs.h"
+#include "opus_kernels.h"
+#include "opus_memory.h"
+#include "opus_profiler.h"
+#include "opus_tasks.h"
 
 
 extern "C" {
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Heap Traffic
+namespace opus::memory
+{
+    // Blocks the allocators below took from the heap. Once they are warm a
+    // frame runs without adding to these; the counts prove it.
+    struct Stats
+    {
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+        uint64_t bytes = 0; // Held right now
+    };
+
+    Stats GetStats();
+
+    // Counted heap blocks; alignment must be a power of two
+    void* AllocateBlock(size_t size, size_t alignment);
+    void FreeBlock(void* block, size_t size, size_t alignment);
+}
+
+// Class FrameArena
+namespace opus::memory
+{
+    // Bump-pointer scratch memory. Allocating is an add and a compare, and
+    // nothing is freed one by one: Rewind() drops everything after a mark,
+    // Reset() drops it all. Storage is kept, and after a frame that needed
+    // several chunks Reset() merges them into one, so a steady workload
+    // stops allocating after its first frames. Not thread-safe.
+    class FrameArena
+    {
+    public:
+        static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+        static constexpr size_t CHUNK_ALIGNMENT = 64;
+
+        struct Mark
+        {
+            size_t chunk = 0;
+            size_t offset = 0;
+            size_t used = 0;
+            uint64_t reset = 0; // Marks from before a Reset() are ignored
+        };
+
+        // Constructor and Destructor
+        explicit FrameArena(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+        ~FrameArena();
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        // Allocation. Memory is uninitialized and lives until the next
+        // Rewind() past it or Reset().
+        void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        template <typename T>
+        T* AllocateArray(size_t count)
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "arena memory is dropped without destructors");
+            return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        // Control
+        Mark GetMark() const;
+        void Rewind(const Mark& mark); // Frees everything allocated after the mark
+        void Reset(); // Frees everything; call with no ArenaScope open
+
+        // Getters
+        size_t GetUsed() const; // Bytes since the last reset, padding included
+        size_t GetCapacity() const;
+        size_t GetPeak() const; // Most bytes used at once
+
+    private:
+        struct Chunk
+        {
+            std::byte* data;
+            size_t size;
+        };
+
+        std::vector<Chunk> m_chunks;
+        size_t m_chunkSize;
+        size_t m_chunk = 0; // Chunk being carved
+        size_t m_offset = 0;
+        size_t m_used = 0;
+        size_t m_peak = 0;
+        uint64_t m_resets = 0;
+    };
+
+    // Returns the scratch the enclosed code allocated when it goes out of scope
+    class ArenaScope
+    {
+    public:
+        // Constructor and Destructor
+        explicit ArenaScope(FrameArena& arena) : m_arena(arena), m_mark(arena.GetMark()) {}
+        ~ArenaScope() { m_arena.Rewind(m_mark); }
+
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+
+        // Getters
+        FrameArena& GetArena() const { return m_arena; }
+
+    private:
+        FrameArena& m_arena;
+        FrameArena::Mark m_mark;
+    };
+
+    // Standard allocator over an arena, for containers that live inside a
+    // scope or a frame. Deallocation does nothing, so reserve() up front
+    // rather than growing a container many times.
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator(FrameArena& arena) noexcept : m_arena(&arena) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.GetArena()) {}
+
+        T* allocate(size_t count) { return static_cast<T*>(m_arena->Allocate(sizeof(T) * count, alignof(T))); }
+        void deallocate(T* /*block*/, size_t /*count*/) noexcept {}
+
+        FrameArena* GetArena() const noexcept { return m_arena; }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const noexcept { return m_arena == other.GetArena(); }
+
+    private:
+        FrameArena* m_arena;
+    };
+
+    template <typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+    // The calling thread's arena. The core resets the update thread's at the
+    // top of retro_run, so anything taken from it outside a scope lasts one
+    // frame, and JobPool::NextFrame() has each worker reset its own before
+    // the next job it takes. A worker runs many jobs between resets, so code
+    // that may run on a pool (task updates, for one) still keeps its scratch
+    // inside an ArenaScope.
+    FrameArena& GetFrameArena();
+}
+
+// Class ObjectPool
+namespace opus::memory
+{
+    // Slots for long-lived objects of one type (drawables, tasks, sprites),
+    // carved from chunks and recycled through a free list. Creating and
+    // destroying objects does not touch the heap once the pool has grown to
+    // the busiest count; Reserve() gets it there up front. Not thread-safe.
+    // Destroy every object before the pool.
+    template <typename T, size_t ObjectsPerChunk = 64>
+    class ObjectPool
+    {
+    public:
+        // Constructor and Destructor
+        ObjectPool() = default;
+        ~ObjectPool()
+        {
+            for (Slot* chunk : m_chunks)
+                FreeBlock(chunk, sizeof(Slot) * ObjectsPerChunk, alignof(Slot));
+        }
+
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        // Control
+        template <typename... Args>
+        T* Create(Args&&... args)
+        {
+            if (!m_free)
+                AddChunk();
+
+            Slot* slot = m_free;
+            m_free = slot->next;
+            try
+            {
+                T* object = ::new (static_cast<void*>(slot->storage)) T(std::forward<Args>(args)...);
+                ++m_live;
+                return object;
+            }
+            catch (...)
+            {
+                slot->next = m_free;
+                m_free = slot;
+                throw;
+            }
+        }
+
+        void Destroy(T* object)
+        {
+            if (!object)
+                return;
+
+            object->~T();
+            Slot* slot = reinterpret_cast<Slot*>(object);
+            slot->next = m_free;
+            m_free = slot;
+            --m_live;
+        }
+
+        void Reserve(size_t count)
+        {
+            while (GetCapacity() < count)
+                AddChunk();
+        }
+
+        // Getters
+        size_t GetLiveCount() const { return m_live; }
+        size_t GetCapacity() const { return m_chunks.size() * ObjectsPerChunk; }
+
+    private:
+        union Slot
+        {
+            Slot* next;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+
+        void AddChunk()
+        {
+            Slot* chunk = static_cast<Slot*>(AllocateBlock(sizeof(Slot) * ObjectsPerChunk, alignof(Slot)));
+            m_chunks.push_back(chunk);
+
+            // Lowest address first, so fresh objects are laid out in order
+            for (size_t i = ObjectsPerChunk; i-- > 0;)
+            {
+                chunk[i].next = m_free;
+                m_free = &chunk[i];
+            }
+        }
+
+        std::vector<Slot*> m_chunks;
+        Slot* m_free = nullptr;
+        size_t m_live = 0;
+    };
+}
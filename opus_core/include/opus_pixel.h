@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OPUS_PIXEL_SSE2 1
+#include <emmintrin.h>
+#else
+#define OPUS_PIXEL_SSE2 0
+#endif
+
+// Pixel Formats
+namespace opus::gfx
+{
+    enum class PixelFormat : uint8_t
+    {
+        RGB565,   // 16 bpp, RETRO_PIXEL_FORMAT_RGB565
+        XRGB8888, // 32 bpp, RETRO_PIXEL_FORMAT_XRGB8888
+        Indexed8, // 8 bpp palette indices; expanded to a frontend format to present
+        XRGB1555, // 16 bpp, RETRO_PIXEL_FORMAT_0RGB1555
+    };
+
+    constexpr uint32_t BytesPerPixel(PixelFormat format)
+    {
+        switch (format)
+        {
+        case PixelFormat::XRGB8888: return 4u;
+        case PixelFormat::Indexed8: return 1u;
+        default: return 2u;
+        }
+    }
+}
+
+// Pixel Format Traits
+namespace opus::gfx::pixel
+{
+    // Each trait converts between its storage and 0x00RRGGBB. Narrowing
+    // truncates; widening replicates the top bits, so white stays white.
+    struct XRGB8888
+    {
+        using Storage = uint32_t;
+        static constexpr PixelFormat FORMAT = PixelFormat::XRGB8888;
+
+        static constexpr Storage FromXRGB(uint32_t xrgb) { return xrgb & 0x00FFFFFFu; }
+        static constexpr uint32_t ToXRGB(Storage p) { return p & 0x00FFFFFFu; }
+    };
+
+    struct RGB565
+    {
+        using Storage = uint16_t;
+        static constexpr PixelFormat FORMAT = PixelFormat::RGB565;
+
+        static constexpr Storage FromXRGB(uint32_t xrgb)
+        {
+            return Storage(((xrgb >> 8) & 0xF800u) | ((xrgb >> 5) & 0x07E0u) | ((xrgb >> 3) & 0x001Fu));
+        }
+
+        static constexpr uint32_t ToXRGB(Storage p)
+        {
+            const uint32_t r = (p >> 11) & 0x1Fu;
+            const uint32_t g = (p >> 5) & 0x3Fu;
+            const uint32_t b = p & 0x1Fu;
+            return (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+        }
+    };
+
+    struct XRGB1555
+    {
+        using Storage = uint16_t;
+        static constexpr PixelFormat FORMAT = PixelFormat::XRGB1555;
+
+        static constexpr Storage FromXRGB(uint32_t xrgb)
+        {
+            return Storage(((xrgb >> 9) & 0x7C00u) | ((xrgb >> 6) & 0x03E0u) | ((xrgb >> 3) & 0x001Fu));
+        }
+
+        static constexpr uint32_t ToXRGB(Storage p)
+        {
+            const uint32_t r = (p >> 10) & 0x1Fu;
+            const uint32_t g = (p >> 5) & 0x1Fu;
+            const uint32_t b = p & 0x1Fu;
+            return (((r << 3) | (r >> 2)) << 16) | (((g << 3) | (g >> 2)) << 8) | ((b << 3) | (b >> 2));
+        }
+    };
+
+    template <typename Dst, typename Src>
+    constexpr typename Dst::Storage ConvertPixel(typename Src::Storage p)
+    {
+        if constexpr (std::is_same_v<Src, Dst>)
+            return p;
+        else
+            return Dst::FromXRGB(Src::ToXRGB(p));
+    }
+}
+
+// Batch Conversion
+namespace opus::gfx::pixel
+{
+    namespace detail
+    {
+#if OPUS_PIXEL_SSE2
+        // Packs the low 16 bits of each 32-bit lane without signed saturation
+        inline __m128i PackLow16(__m128i a, __m128i b)
+        {
+            a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+            b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+            return _mm_packs_epi32(a, b);
+        }
+
+        // 8 x 0x00RRGGBB to 8 x 16 bpp (565 or 1555 per the shifts)
+        template <int RShift, uint32_t RMask, int GShift, uint32_t GMask>
+        inline size_t NarrowSSE2(const uint32_t* src, uint16_t* dst, size_t count)
+        {
+            const __m128i rMask = _mm_set1_epi32(int32_t(RMask));
+            const __m128i gMask = _mm_set1_epi32(int32_t(GMask));
+            const __m128i bMask = _mm_set1_epi32(0x1F);
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m128i p[2];
+                for (int half = 0; half < 2; ++half)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + half * 4));
+                    p[half] = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, RShift), rMask),
+                                                        _mm_and_si128(_mm_srli_epi32(v, GShift), gMask)),
+                                           _mm_and_si128(_mm_srli_epi32(v, 3), bMask));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), PackLow16(p[0], p[1]));
+            }
+            return i;
+        }
+
+        // 8 x 16 bpp to 8 x 0x00RRGGBB, replicating top bits into the gaps
+        template <int RShift, int GShift, int GBits>
+        inline size_t WidenSSE2(const uint16_t* src, uint32_t* dst, size_t count)
+        {
+            const __m128i five = _mm_set1_epi32(0x1F);
+            const __m128i gMask = _mm_set1_epi32((1 << GBits) - 1);
+            const __m128i zero = _mm_setzero_si128();
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                const __m128i halves[2] = {_mm_unpacklo_epi16(v, zero), _mm_unpackhi_epi16(v, zero)};
+                for (int half = 0; half < 2; ++half)
+                {
+                    const __m128i p = halves[half];
+                    __m128i r = _mm_and_si128(_mm_srli_epi32(p, RShift), five);
+                    __m128i g = _mm_and_si128(_mm_srli_epi32(p, GShift), gMask);
+                    __m128i b = _mm_and_si128(p, five);
+                    r = _mm_or_si128(_mm_slli_epi32(r, 3), _mm_srli_epi32(r, 2));
+                    g = _mm_or_si128(_mm_slli_epi32(g, 8 - GBits), _mm_srli_epi32(g, 2 * GBits - 8));
+                    b = _mm_or_si128(_mm_slli_epi32(b, 3), _mm_srli_epi32(b, 2));
+                    const __m128i out = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 16), _mm_slli_epi32(g, 8)), b);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + half * 4), out);
+                }
+            }
+            return i;
+        }
+
+        // 8 x 565 to 8 x 1555 or back; only the green field changes width
+        template <bool To1555>
+        inline size_t Repack16SSE2(const uint16_t* src, uint16_t* dst, size_t count)
+        {
+            const __m128i five = _mm_set1_epi16(0x1F);
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                __m128i out;
+                if constexpr (To1555)
+                    out = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 1), _mm_set1_epi16(0x7FE0)),
+                                       _mm_and_si128(p, five));
+                else
+                    out = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi16(p, 1), _mm_set1_epi16(int16_t(0xFFC0))),
+                                                    _mm_and_si128(_mm_srli_epi16(p, 4), _mm_set1_epi16(0x20))),
+                                       _mm_and_si128(p, five));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+            }
+            return i;
+        }
+#endif
+    }
+
+    // Converts count pixels. The vector paths are SSE2, which every x64
+    // target has, so no runtime dispatch is needed; the scalar loop handles
+    // the tail and other targets.
+    template <typename Src, typename Dst>
+    inline void Convert(const typename Src::Storage* src, typename Dst::Storage* dst, size_t count)
+    {
+        size_t done = 0;
+#if OPUS_PIXEL_SSE2
+        if constexpr (std::is_same_v<Src, XRGB8888> && std::is_same_v<Dst, RGB565>)
+            done = detail::NarrowSSE2<8, 0xF800u, 5, 0x07E0u>(src, dst, count);
+        else if constexpr (std::is_same_v<Src, XRGB8888> && std::is_same_v<Dst, XRGB1555>)
+            done = detail::NarrowSSE2<9, 0x7C00u, 6, 0x03E0u>(src, dst, count);
+        else if constexpr (std::is_same_v<Src, RGB565> && std::is_same_v<Dst, XRGB8888>)
+            done = detail::WidenSSE2<11, 5, 6>(src, dst, count);
+        else if constexpr (std::is_same_v<Src, XRGB1555> && std::is_same_v<Dst, XRGB8888>)
+            done = detail::WidenSSE2<10, 5, 5>(src, dst, count);
+        else if constexpr (std::is_same_v<Src, RGB565> && std::is_same_v<Dst, XRGB1555>)
+            done = detail::Repack16SSE2<true>(src, dst, count);
+        else if constexpr (std::is_same_v<Src, XRGB1555> && std::is_same_v<Dst, RGB565>)
+            done = detail::Repack16SSE2<false>(src, dst, count);
+#endif
+        for (size_t i = done; i < count; ++i)
+            dst[i] = ConvertPixel<Dst, Src>(src[i]);
+    }
+
+    template <typename Src, typename Dst>
+    inline void Convert(std::span<const typename Src::Storage> src, std::span<typename Dst::Storage> dst)
+    {
+        Convert<Src, Dst>(src.data(), dst.data(), src.size() < dst.size() ? src.size() : dst.size());
+    }
+
+    // Calls fn with the trait for a direct-colour format, so runtime formats
+    // reach code specialized at compile time. False for Indexed8.
+    template <typename Fn>
+    inline bool Visit(PixelFormat format, Fn&& fn)
+    {
+        switch (format)
+        {
+        case PixelFormat::XRGB8888: fn(XRGB8888{}); return true;
+        case PixelFormat::RGB565: fn(RGB565{}); return true;
+        case PixelFormat::XRGB1555: fn(XRGB1555{}); return true;
+        default: return false;
+        }
+    }
+}
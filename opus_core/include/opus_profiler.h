@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Hot-path instrumentation. Build with OPUS_PROFILE defined to record scopes;
+// without it the OPUS_PROFILE_* macros expand to nothing.
+namespace opus::profiler
+{
+    struct Event
+    {
+        const char* name; // Must have static storage (string literal, type name)
+        uint64_t begin;   // ns, steady clock
+        uint64_t end;     // ns, steady clock
+    };
+
+    // Timestamps
+    uint64_t NowNs();
+
+    // Recording (lock-free, per-thread ring buffer; oldest events are overwritten)
+    void Record(const char* name, uint64_t begin, uint64_t end);
+
+    // Export. Safe while other threads record: events overwritten during the
+    // export are left out rather than torn.
+    std::string ChromeTrace(); // Chrome trace-event JSON (chrome://tracing, Perfetto)
+    bool WriteChromeTrace(const char* path);
+    void Reset(); // Drops what was recorded so far from later exports
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name) : m_name(name), m_begin(NowNs()) {}
+        ~Scope() { Record(m_name, m_begin, NowNs()); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name;
+        uint64_t m_begin;
+    };
+}
+
+#define OPUS_PROFILE_CONCAT_IMPL(a, b) a##b
+#define OPUS_PROFILE_CONCAT(a, b) OPUS_PROFILE_CONCAT_IMPL(a, b)
+
+#if defined(OPUS_PROFILE)
+#define OPUS_PROFILE_SCOPE(name) ::opus::profiler::Scope OPUS_PROFILE_CONCAT(opusProfileScope, __LINE__)(name)
+#else
+#define OPUS_PROFILE_SCOPE(name) ((void)0)
+#endif
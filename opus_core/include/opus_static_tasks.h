@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+#include "opus_tasks.h"
+
+// Class StaticTask
+namespace opus::tasks
+{
+    // Compile-time counterpart of Task for fixed pipelines. Derived provides a
+    // public, non-virtual OnUpdate(uint64_t) and may hide OnInitialize(). Modulo
+    // and offset are template arguments, so the gate folds to nothing for
+    // modulo 1 and to a mask for powers of two. Enable/internal-count semantics
+    // match Task.
+    template <typename Derived, uint32_t Modulo = 1, uint32_t Offset = 0, bool Internal = false>
+    class StaticTask
+    {
+    public:
+        static constexpr uint32_t MODULO = Modulo == 0 ? 1u : Modulo;
+        static constexpr uint32_t OFFSET = Offset % MODULO;
+        static constexpr bool INTERNAL = Internal;
+
+        // Constructor and Destructor
+        explicit StaticTask(bool enable = true) : m_enabled(enable) {}
+
+        // Life Cycle
+        void Initialize()
+        {
+            if (m_initialized)
+                return;
+
+            Self().OnInitialize();
+            m_initialized = true;
+        }
+
+        void Update() { UpdateImpl(m_count, true); } // For Internal Counter
+        void Update(uint64_t count) { UpdateImpl(count, false); } // For External Counter
+
+        // Control
+        void Enable() { m_enabled = true; }
+        void Disable() { m_enabled = false; }
+        void ResetCount() { m_count = 0; }
+
+        // State
+        bool IsEnabled() const { return m_enabled; }
+        bool IsInitialized() const { return m_initialized; }
+        uint64_t Count() const { return m_count; }
+
+        static constexpr bool IsDue(uint64_t taskCount)
+        {
+            if constexpr (MODULO == 1)
+                return true;
+            else if constexpr ((MODULO & (MODULO - 1)) == 0)
+                return ((taskCount + OFFSET) & (MODULO - 1)) == 0;
+            else
+                return ((taskCount + OFFSET) % MODULO) == 0;
+        }
+
+        void OnInitialize() {}
+
+    private:
+        Derived& Self() { return static_cast<Derived&>(*this); }
+
+        void UpdateImpl(uint64_t count, bool useInternal)
+        {
+            if (!m_enabled)
+                return;
+
+            if (!m_initialized)
+                Initialize();
+
+            // Select internal or external Task Count
+            uint64_t taskCount = count;
+            if (INTERNAL && !useInternal)
+                taskCount = m_count;
+
+            if (IsDue(taskCount))
+            {
+                Self().OnUpdate(taskCount);
+
+                if constexpr (INTERNAL)
+                    ++m_count;
+            }
+        }
+
+        bool m_enabled = true;
+        bool m_initialized = false;
+        uint64_t m_count = 0; // Internal Task Count
+    };
+}
+
+// Class StaticTaskContainer
+namespace opus::tasks
+{
+    // Stores a fixed pipeline by value and expands its update loop at compile
+    // time. Any type with Update(uint64_t) works: StaticTask, a nested
+    // StaticTaskContainer, or a regular Task subclass (which keeps its virtual
+    // OnUpdate). The container itself is a Task and can be added to a
+    // TaskContainer like any other.
+    template <typename... Ts>
+    class StaticTaskContainer : public Task
+    {
+    public:
+        // Constructor and Destructor
+        StaticTaskContainer() : Task(1, 0, true, false) {}
+        StaticTaskContainer(uint32_t modulo, uint32_t offset, bool enabled, bool internal)
+            : Task(modulo, offset, enabled, internal)
+        {
+        }
+
+        // Access
+        template <size_t I>
+        auto& Get() { return std::get<I>(m_tasks); }
+
+        template <typename T>
+        T& Get() { return std::get<T>(m_tasks); }
+
+        static constexpr size_t Size() { return sizeof...(Ts); }
+
+    protected:
+        void OnUpdate(uint64_t count) override
+        {
+            // In declaration order, like TaskContainer's insertion order
+            std::apply([count](Ts&... tasks) { (tasks.Update(count), ...); }, m_tasks);
+        }
+
+    private:
+        std::tuple<Ts...> m_tasks;
+    };
+}
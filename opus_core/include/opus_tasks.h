@@ -1,16 +1,27 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <vector>
 #include <functional>
 
+#include "opus_jobs.h"
+
 namespace opus::tasks
 {
+    class TaskContainer;
+    class DeferredTaskContainer;
+
     class Task
     {
     public:
-        // Constructor and Destructor
+        // Constructor and Destructor. Destroy a task on its parent's update
+        // thread: the destructor drops it from the parent and its edges at
+        // once. Elsewhere, RemoveTask it and wait for GetParent() to return
+        // nullptr; with no dependency edges left, the destructor then touches
+        // nothing shared.
         Task();
         Task(uint32_t modulo, uint32_t offset, bool enable, bool internal);
         virtual ~Task();
@@ -20,53 +31,248 @@ namespace opus::tasks
         void Update(); // For Internal Counter
         void Update(uint64_t count); // For External Counter
 
-        // Control
+        // Control. Any thread: a parent applies these to its schedule between
+        // passes, though a child disabled mid-tick is skipped at once.
         void Enable();
         void Disable();
         void ResetCount();
+        void SetIndependent(bool independent); // May run concurrently with its siblings
+        void SetName(const char* name); // Static storage, shown by the profiler
+        // Dependencies. Update thread only, outside of the parent's update.
+        // DependsOn refuses an edge that would close a cycle and returns false.
+        bool DependsOn(Task& task); // Runs after task within a tick (Graph mode siblings)
+        void ClearDependencies();
 
         // State
         bool IsEnabled() const;
         bool IsInternal() const;
         bool IsInitialized() const;
+        bool IsIndependent() const;
         uint64_t Count() const;
+        uint32_t Modulo() const;
+        uint32_t Offset() const;
+        const std::vector<Task*>& Dependencies() const;
+        const char* Name() const; // SetName, else the demangled class name
+        TaskContainer* GetParent() const; // Set by AddTask; nullptr once a Remove was applied
 
     protected:
         virtual void OnInitialize(){}
         virtual void OnUpdate(uint64_t count) = 0;
 
     private:
+        friend class TaskContainer;
+        friend class DeferredTaskContainer;
+
         void UpdateImpl(uint64_t count, bool count_is_internal);
-        bool m_enabled = false; // Enable Task
+        void Dispatch(uint64_t taskCount); // Runs OnUpdate, gating already passed
+
+        std::atomic<bool> m_enabled{false}; // Enable Task
         bool m_internal = false; // Use Interal verse External (Parent Count)
         bool m_initialized = false; // Initialized
+        std::atomic<bool> m_independent{false}; // No ordering against siblings
         uint32_t m_modulo = 1; // Task Modulo
         uint32_t m_offset = 0; // Task Offset
         uint64_t m_count = 0; // Internal Task Count
+        const char* m_name = nullptr; // Optional display name
+        mutable std::atomic<const char*> m_typeName{nullptr}; // Cached class name
+        std::atomic<TaskContainer*> m_parent{nullptr}; // Container this task was added to
+        std::atomic<bool> m_removing{false}; // A queued Remove that a later Add may still cancel
+        bool m_attached = false; // Present in the parent's index (update thread only)
+        uint32_t m_slot = 0; // Index into the parent's scheduling arrays
+        std::vector<Task*> m_dependencies; // Tasks that must run first
+        std::vector<Task*> m_dependents; // Tasks naming this one, unlinked on destruction
     };
 }
 
 namespace opus::tasks
 {
+    enum class ExecutionMode : uint8_t
+    {
+        Serial,   // Every child in insertion order on the calling thread
+        Parallel, // Runs of independent children are spread over the job pool
+        Graph,    // Children run in dependency waves, each wave concurrently
+    };
+
     class TaskContainer : public Task
     {
     public:
         // Constructor and Destructor
         TaskContainer();
         TaskContainer(uint32_t modulo, uint32_t offset, bool enabled, bool internal);
-        ~TaskContainer() override = default;
+        ~TaskContainer() override;
 
         // Control
+        // Add/Remove may be called from any thread, including from a child's
+        // OnUpdate. They are queued and take effect at the top of the next update
+        // (or at ApplyPending). false if the task belongs to another container.
+        // Adding a task whose Remove is still queued cancels the Remove.
         bool AddTask(Task& task);
         bool RemoveTask(Task& task);
+        void ApplyPending(); // Update thread only
+        bool SetExecutionMode(ExecutionMode mode); // Graph: builds it now, false on a cycle
+        void SetJobPool(opus::jobs::JobPool* pool); // nullptr = serial
+        bool BuildGraph(); // false if dependencies form a cycle; those children are not run
+
+        // State
+        ExecutionMode GetExecutionMode() const;
+        bool IsGraphValid() const;
+        const std::vector<Task*>& CycleTasks() const; // Children on or behind a cycle
 
     protected:
         void OnInitialize() override {}
         void OnUpdate(uint64_t count) override;
 
     private:
+        friend class Task;
+
+        // Scheduling state of the attached children lives here as parallel
+        // arrays indexed by slot, in insertion order. Gating reads only these;
+        // a Task object is touched when it is actually dispatched.
+        enum SlotFlags : uint8_t
+        {
+            SLOT_ENABLED = 1 << 0,
+            SLOT_INTERNAL = 1 << 1,
+            SLOT_INDEPENDENT = 1 << 2,
+        };
+
+        // Children with an external count, keyed by the residue of the parent
+        // count at which they are due: (count + offset) % modulo == 0. One
+        // flat sorted array per period; a group outlives its last child so
+        // its storage is reused.
+        struct ModuloGroup
+        {
+            uint32_t modulo;
+            std::vector<uint64_t> entries; // (residue << 32) | slot, ascending
+        };
+
+        struct Command
+        {
+            enum class Type : uint8_t { Add, Remove, Flag, ResetCount };
+            Type type;
+            Task* task;
+            uint8_t flag = 0; // Flag: the SlotFlags bit and its new value
+            bool value = false;
+        };
+
+        void Attach(Task& task);
+        void Detach(Task& task);
+        void Forget(Task& task); // A child is being destroyed
+        void Compact();
+        void SetSlotFlag(uint32_t slot, uint8_t flag, bool value);
+        void Index(uint32_t slot);
+        void Unindex(uint32_t slot);
+        void CollectDue(uint64_t count);
+        void RunChild(uint32_t slot, uint64_t count);
+        void RunBatch(uint64_t count);
+        void RunIndependent(uint64_t count);
+        void RunWaves(uint64_t count);
+
+        opus::jobs::CommandQueue<Command> m_commands;
+
+        // Per-slot state (cleared slots hold nullptr until compaction)
         std::vector<Task*> m_tasks;
+        std::vector<uint32_t> m_modulos;
+        std::vector<uint32_t> m_offsets;
+        std::vector<uint64_t> m_counts; // Internal children's own count
+        std::vector<uint32_t> m_waves; // Dependency wave
+        std::vector<uint8_t> m_flags; // SlotFlags
+
+        std::vector<ModuloGroup> m_groups;
+        std::vector<uint32_t> m_selfClocked; // Internal-count children, gated by their own count
+        std::vector<uint32_t> m_due; // Slots to visit this tick, in insertion order
+        std::vector<uint32_t> m_batch; // Independent slots waiting to be dispatched
+        std::vector<Task*> m_cycle;
+        uint32_t m_cycleWave = 0; // Wave holding the cycle, never run
+        std::atomic<bool> m_graphDirty{true};
+        bool m_graphValid = true;
+        bool m_compact = false; // Cleared slots to squeeze out
+        bool m_updating = false; // Slots must stay put while true
+        ExecutionMode m_mode = ExecutionMode::Serial;
+        opus::jobs::JobPool* m_pool = nullptr;
+    };
+}
+
+namespace opus::tasks
+{
+    // Work that may slip a frame (cache warming, decompression, pathing).
+    // Runs from a DeferredTaskContainer in the time left over in a frame.
+    class DeferrableTask : public Task
+    {
+    public:
+        // Constructor and Destructor. As for Task, off the container's update
+        // thread only once GetQueue() returned nullptr after RemoveTask.
+        DeferrableTask();
+        DeferrableTask(uint32_t priority, uint32_t modulo, uint32_t offset, bool enabled);
+        ~DeferrableTask() override;
+
+        // Control
+        void SetPriority(uint32_t priority); // Higher runs first
+
+        // State
+        uint32_t Priority() const;
+        bool IsPending() const;
+        uint64_t CostNs() const; // Running average of OnUpdate time
+        DeferredTaskContainer* GetQueue() const; // Set by AddTask; nullptr once a Remove was applied
+
+    private:
+        friend class DeferredTaskContainer;
+
+        uint32_t m_priority = 0;
+        bool m_pending = false; // Due, waiting for budget
+        uint64_t m_pendingCount = 0; // Count the task became due at
+        uint64_t m_pendingOrder = 0; // Older pending work first within a priority
+        uint64_t m_costNs = 0;
+        uint32_t m_skips = 0; // Ticks passed over since it last ran; each halves the estimate
+        std::atomic<DeferredTaskContainer*> m_queue{nullptr}; // Container this task was added to
     };
 }
 
+namespace opus::tasks
+{
+    // Runs due deferrable tasks by priority while they fit before the deadline;
+    // whatever does not fit stays pending and is served first on the next tick.
+    class DeferredTaskContainer : public Task
+    {
+    public:
+        // Constructor and Destructor
+        DeferredTaskContainer();
+        ~DeferredTaskContainer() override;
 
+        // Control
+        // Add/Remove are queued like TaskContainer's: any thread, applied at
+        // the top of the next update, and an Add cancels a queued Remove. A
+        // task with a Remove queued is not run.
+        bool AddTask(DeferrableTask& task);
+        bool RemoveTask(DeferrableTask& task);
+        void ApplyPending(); // Update thread only
+        void SetDeadline(uint64_t deadlineNs); // opus::profiler::NowNs() clock, 0 = none
+
+        // State
+        uint64_t Deadline() const;
+        size_t NumPending() const;
+
+    protected:
+        void OnUpdate(uint64_t count) override;
+
+    private:
+        friend class DeferrableTask;
+
+        struct Command
+        {
+            enum class Type : uint8_t { Add, Remove };
+            Type type;
+            DeferrableTask* task;
+        };
+
+        void Attach(DeferrableTask& task);
+        void Detach(DeferrableTask& task);
+        void Forget(DeferrableTask& task); // A task is being destroyed
+
+        opus::jobs::CommandQueue<Command> m_commands;
+        std::vector<DeferrableTask*> m_tasks;
+        std::vector<DeferrableTask*> m_pending; // Kept in run order
+        uint64_t m_deadlineNs = 0;
+        uint64_t m_nextOrder = 0;
+        bool m_running = false; // Inside the run loop: removal leaves a hole
+    };
+}
@@ -0,0 +1,204 @@
+#include "opus_coroutine.h"
+
+#include <array>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "opus_memory.h"
+
+namespace
+{
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    constexpr size_t CHUNK_SIZE = 64 * 1024;
+    constexpr size_t CHUNK_ALIGNMENT = opus::tasks::FramePool::CLASS_SIZE;
+
+    // Chunks live as long as the process: once carved, their blocks may sit
+    // in any thread's lists. Taken under the lock only when a chunk is added.
+    struct ChunkList
+    {
+        ~ChunkList()
+        {
+            for (std::byte* chunk : chunks)
+                opus::memory::FreeBlock(chunk, CHUNK_SIZE, CHUNK_ALIGNMENT);
+        }
+
+        std::mutex mutex;
+        std::vector<std::byte*> chunks;
+    };
+
+    struct ThreadPool
+    {
+        std::array<FreeBlock*, opus::tasks::FramePool::NUM_CLASSES> freeLists{};
+        std::byte* cursor = nullptr; // Unused tail of this thread's newest chunk
+        size_t remaining = 0;
+    };
+
+    ChunkList& GetChunks()
+    {
+        static ChunkList chunks;
+        return chunks;
+    }
+
+    thread_local ThreadPool t_pool;
+
+    size_t ClassOf(size_t size)
+    {
+        return (size + opus::tasks::FramePool::CLASS_SIZE - 1) / opus::tasks::FramePool::CLASS_SIZE - 1;
+    }
+}
+
+// Class FramePool
+namespace opus::tasks
+{
+    void* FramePool::Allocate(size_t size)
+    {
+        const size_t sizeClass = ClassOf(size);
+        if (sizeClass >= NUM_CLASSES)
+            return ::operator new(size);
+
+        ThreadPool& pool = t_pool;
+        if (FreeBlock* block = pool.freeLists[sizeClass])
+        {
+            pool.freeLists[sizeClass] = block->next;
+            return block;
+        }
+
+        const size_t blockSize = (sizeClass + 1) * CLASS_SIZE;
+        if (pool.remaining < blockSize)
+        {
+            std::byte* chunk = static_cast<std::byte*>(opus::memory::AllocateBlock(CHUNK_SIZE, CHUNK_ALIGNMENT));
+            ChunkList& chunks = GetChunks();
+            {
+                std::lock_guard<std::mutex> lock(chunks.mutex);
+                chunks.chunks.push_back(chunk);
+            }
+            pool.cursor = chunk;
+            pool.remaining = CHUNK_SIZE;
+        }
+
+        void* block = pool.cursor;
+        pool.cursor += blockSize;
+        pool.remaining -= blockSize;
+        return block;
+    }
+
+    void FramePool::Free(void* block, size_t size)
+    {
+        const size_t sizeClass = ClassOf(size);
+        if (sizeClass >= NUM_CLASSES)
+        {
+            ::operator delete(block);
+            return;
+        }
+
+        ThreadPool& pool = t_pool;
+        FreeBlock* freed = static_cast<FreeBlock*>(block);
+        freed->next = pool.freeLists[sizeClass];
+        pool.freeLists[sizeClass] = freed;
+    }
+}
+
+// Class Routine
+namespace opus::tasks
+{
+    Routine& Routine::operator=(Routine&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    Routine::~Routine()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+}
+
+// Awaitables
+namespace opus::tasks
+{
+    void TickAwaiter::await_suspend(Routine::Handle handle) noexcept
+    {
+        handle.promise().task->m_waitTicks = ticks;
+    }
+
+    void CompletionAwaiter::await_suspend(Routine::Handle handle) noexcept
+    {
+        handle.promise().task->m_waitFor = done;
+    }
+
+    CompletionAwaiter operator co_await(const CoroutineTask& task) noexcept
+    {
+        return CompletionAwaiter{&task.m_finished};
+    }
+}
+
+// Class CoroutineTask
+namespace opus::tasks
+{
+    CoroutineTask::CoroutineTask()
+        : Task(1, 0, true, false)
+    {
+    }
+
+    CoroutineTask::CoroutineTask(uint32_t modulo, uint32_t offset, bool enable, bool internal)
+        : Task(modulo, offset, enable, internal)
+    {
+    }
+
+    void CoroutineTask::Restart()
+    {
+        m_routine = Routine();
+        m_waitTicks = 0;
+        m_waitFor = nullptr;
+        m_finished.store(false, std::memory_order_release);
+    }
+
+    bool CoroutineTask::IsFinished() const
+    {
+        return m_finished.load(std::memory_order_acquire);
+    }
+
+    uint64_t CoroutineTask::CurrentCount() const
+    {
+        return m_currentCount;
+    }
+
+    void CoroutineTask::OnUpdate(uint64_t count)
+    {
+        if (!m_routine.IsValid())
+        {
+            m_routine = Run();
+            m_routine.GetHandle().promise().task = this;
+        }
+
+        if (m_routine.IsDone())
+            return;
+
+        // Still waiting on a suspension condition
+        if (m_waitTicks > 1)
+        {
+            --m_waitTicks;
+            return;
+        }
+        if (m_waitFor && !m_waitFor->load(std::memory_order_acquire))
+            return;
+
+        m_waitTicks = 0;
+        m_waitFor = nullptr;
+        m_currentCount = count;
+        m_routine.GetHandle().resume();
+        if (m_routine.IsDone())
+            m_finished.store(true, std::memory_order_release);
+    }
+}
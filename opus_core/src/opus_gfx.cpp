@@ -1,180 +1,1527 @@
 #include "opus_gfx.h"
 
-// Class ColorXRGB
-namespace opus::gfx
+#include <bit>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "opus_kernels.h"
+#include "opus_profiler.h"
+
+namespace
 {
-    // Constructor
-    Color::Color() : m_color(0) 
+    // Pixels a merged rect would redraw that neither input covers
+    int64_t MergeCost(const opus::gfx::Rect& a, const opus::gfx::Rect& b)
     {
+        return a.Union(b).Area() - a.Area() - b.Area();
     }
-    Color::Color(uint32_t xrgb) : m_color(xrgb) 
+
+    // Overlapping or abutting rects are merged so no pixel is drawn twice
+    void AddDirtyRect(std::vector<opus::gfx::Rect>& rects, opus::gfx::Rect rect)
     {
+        if (rect.IsEmpty())
+            return;
+
+        for (size_t i = 0; i < rects.size();)
+        {
+            if (rects[i].Intersects(rect) || MergeCost(rects[i], rect) <= 0)
+            {
+                rect = rect.Union(rects[i]);
+                rects[i] = rects.back();
+                rects.pop_back();
+                i = 0; // The grown rect may now reach earlier ones
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        rects.push_back(rect);
     }
-    Color::~Color()
+
+    // Tile rows are short, so inline moves beat a memcpy call per tile
+    inline void CopyRun(uint8_t* dst, const uint8_t* src, size_t bytes)
     {
+        for (; bytes >= 16; dst += 16, src += 16, bytes -= 16)
+            std::memcpy(dst, src, 16);
+        if (bytes >= 8)
+        {
+            std::memcpy(dst, src, 8);
+            dst += 8;
+            src += 8;
+            bytes -= 8;
+        }
+        if (bytes >= 4)
+        {
+            std::memcpy(dst, src, 4);
+            dst += 4;
+            src += 4;
+            bytes -= 4;
+        }
+        if (bytes >= 2)
+        {
+            std::memcpy(dst, src, 2);
+            dst += 2;
+            src += 2;
+            bytes -= 2;
+        }
+        if (bytes)
+            *dst = *src;
     }
 
-    // Getters
-    uint32_t Color::GetXRGB() const 
+    // Stable sort by the low keyBits of a key: one counting pass per key
+    // byte. Linear in the item count, and the scratch vector is kept by the
+    // caller, so sorting every frame does not allocate.
+    template <typename T, typename KeyFn>
+    void RadixSort(std::vector<T>& items, std::vector<T>& scratch, uint32_t keyBits, KeyFn key)
     {
-        return uint32_t(m_color);
+        scratch.resize(items.size());
+        for (uint32_t shift = 0; shift < keyBits; shift += 8)
+        {
+            std::array<size_t, 257> offsets{};
+            for (const T& item : items)
+                ++offsets[((key(item) >> shift) & 0xFFu) + 1];
+            for (size_t i = 1; i < offsets.size(); ++i)
+                offsets[i] += offsets[i - 1];
+            for (const T& item : items)
+                scratch[offsets[(key(item) >> shift) & 0xFFu]++] = item;
+            items.swap(scratch);
+        }
     }
-    uint32_t Color::GetRGB() const 
+
+    // Grid cells a rect covers, both ends included; 64-bit, since bounds
+    // such as Drawable::GetBounds()'s default reach past INT32_MAX
+    struct CellRange
     {
-        return (m_color & 0x00FFFFFFu);
-    } 
-    uint8_t Color::GetX() const 
+        int64_t x0, y0, x1, y1;
+
+        int64_t Count() const { return (x1 - x0 + 1) * (y1 - y0 + 1); }
+    };
+
+    CellRange CellsOf(const opus::gfx::Rect& rect, int32_t shift)
     {
-        return uint8_t((m_color >> 24) & 0xFFu);
+        return CellRange{rect.x >> shift, rect.y >> shift, (int64_t(rect.x) + rect.w - 1) >> shift,
+                         (int64_t(rect.y) + rect.h - 1) >> shift};
     }
-    uint8_t Color::GetR() const 
+
+    size_t CellBucket(int64_t cx, int64_t cy, size_t buckets)
     {
-        return uint8_t((m_color >> 16) & 0xFFu);
+        return size_t((uint64_t(cx) * 73856093u) ^ (uint64_t(cy) * 19349663u)) & (buckets - 1);
     }
-    uint8_t Color::GetG() const 
+}
+
+// Class PaletteXRGB
+namespace opus::gfx
+{
+        // Constructor and Destructor
+        Palette::Palette() : m_numColors(0), m_palette{}
+        {
+            m_stale.fill(~0ull);
+        }
+        Palette::~Palette()
+        {
+        };
+
+        // Getters
+        uint16_t Palette::GetNumColor() const
+        {
+            return m_numColors;
+        }
+        uint64_t Palette::GetVersion() const
+        {
+            return m_version;
+        }
+        const Color& Palette::GetColor(uint8_t index) const 
+        {
+            return m_palette[index];
+        }
+
+        const uint16_t* Palette::GetRGB565Table() const
+        {
+            Refresh();
+            return m_rgb565.data();
+        }
+        const uint32_t* Palette::GetXRGB8888Table() const
+        {
+            Refresh();
+            return m_xrgb8888.data();
+        }
+
+        // Setters
+        void Palette::SetColor(uint8_t index, const Color& color)
+        {
+            m_palette[index] = color;
+            m_numColors = std::max<uint16_t>(m_numColors, uint16_t(index + 1));
+            MarkStale(index);
+        }
+
+        void Palette::Cycle(uint8_t first, uint8_t last, int32_t steps)
+        {
+            if (last <= first)
+                return;
+
+            const int32_t span = int32_t(last) - int32_t(first) + 1;
+            const int32_t shift = ((steps % span) + span) % span;
+            if (shift == 0)
+                return;
+
+            std::rotate(m_palette.begin() + first, m_palette.begin() + (last + 1 - shift), m_palette.begin() + last + 1);
+            for (uint32_t i = first; i <= last; ++i)
+                MarkStale(uint8_t(i));
+        }
+
+        // Helpers
+        void Palette::MarkStale(uint8_t index)
+        {
+            m_stale[index >> 6] |= 1ull << (index & 63);
+            m_anyStale = true;
+            ++m_version;
+        }
+
+        void Palette::Refresh() const
+        {
+            if (!m_anyStale)
+                return;
+
+            for (uint32_t word = 0; word < m_stale.size(); ++word)
+            {
+                for (uint64_t bits = m_stale[word]; bits; bits &= bits - 1)
+                {
+                    const uint32_t index = word * 64 + uint32_t(std::countr_zero(bits));
+                    const Color& color = m_palette[index];
+                    m_xrgb8888[index] = color.Pack<pixel::XRGB8888>();
+                    m_rgb565[index] = color.Pack<pixel::RGB565>();
+                }
+                m_stale[word] = 0;
+            }
+            m_anyStale = false;
+        }
+    }
+
+// Class Surface
+namespace opus::gfx
+{
+    struct Surface::Buffer
+    {
+        ~Buffer()
+        {
+            if (pixels)
+                ::operator delete(pixels, std::align_val_t(ROW_ALIGNMENT));
+        }
+
+        uint8_t* pixels = nullptr; // Owned allocation; null for wrapped memory
+        std::atomic<uint64_t> generation{0};
+    };
+
+    // Constructor and Destructor
+    Surface::Surface() = default;
+
+    Surface::Surface(uint32_t width, uint32_t height, PixelFormat format)
+        : m_width(width),
+          m_height(height),
+          m_format(format)
     {
-        return uint8_t((m_color >>  8) & 0xFFu);
+        const size_t row = size_t(width) * BytesPerPixel(format);
+        m_pitch = (row + ROW_ALIGNMENT - 1) & ~(ROW_ALIGNMENT - 1);
+
+        const size_t size = std::max<size_t>(m_pitch * height, ROW_ALIGNMENT);
+        m_buffer = std::make_shared<Buffer>();
+        m_buffer->pixels = static_cast<uint8_t*>(::operator new(size, std::align_val_t(ROW_ALIGNMENT)));
+        m_data = m_buffer->pixels;
+        m_clip = GetBounds();
+        std::memset(m_data, 0, size);
+    }
+
+    Surface::~Surface() = default;
+
+    // Views
+    Surface Surface::Wrap(void* data, uint32_t width, uint32_t height, size_t pitch, PixelFormat format)
+    {
+        Surface view;
+        view.m_buffer = std::make_shared<Buffer>();
+        view.m_data = static_cast<uint8_t*>(data);
+        view.m_width = width;
+        view.m_height = height;
+        view.m_pitch = pitch;
+        view.m_format = format;
+        view.m_clip = view.GetBounds();
+        return view;
     }
-    uint8_t Color::GetB() const 
+
+    Surface Surface::SubSurface(const Rect& rect) const
     {
-        return uint8_t((m_color >>  0) & 0xFFu);
+        const Rect clipped = rect.Intersect(GetBounds());
+
+        Surface view(*this);
+        view.m_width = uint32_t(clipped.w);
+        view.m_height = uint32_t(clipped.h);
+        view.m_data = clipped.IsEmpty() ? nullptr
+                                        : GetRow(uint32_t(clipped.y)) + size_t(clipped.x) * BytesPerPixel(m_format);
+        view.m_clip = view.GetBounds();
+        return view;
+    }
+
+    // Getters
+    bool Surface::IsValid() const { return m_data != nullptr; }
+    uint32_t Surface::GetWidth() const { return m_width; }
+    uint32_t Surface::GetHeight() const { return m_height; }
+    size_t Surface::GetPitch() const { return m_pitch; }
+    PixelFormat Surface::GetFormat() const { return m_format; }
+    Rect Surface::GetBounds() const { return Rect{0, 0, int32_t(m_width), int32_t(m_height)}; }
+    const Rect& Surface::GetClip() const { return m_clip; }
+    uint8_t* Surface::GetData() const { return m_data; }
+    uint8_t* Surface::GetRow(uint32_t y) const { return m_data + size_t(y) * m_pitch; }
+
+    uint64_t Surface::GetGeneration() const
+    {
+        return m_buffer ? m_buffer->generation.load(std::memory_order_acquire) : 0;
     }
 
     // Setters
-    void Color::SetX(uint8_t x)
+    void Surface::SetClip(const Rect& clip) { m_clip = clip.Intersect(GetBounds()); }
+
+    // Helpers
+    uint32_t Surface::Pack(const Color& color) const
+    {
+        switch (m_format)
+        {
+        case PixelFormat::XRGB8888: return color.Pack<pixel::XRGB8888>();
+        case PixelFormat::XRGB1555: return color.Pack<pixel::XRGB1555>();
+        case PixelFormat::Indexed8: return color.GetB();
+        default: return color.Pack<pixel::RGB565>();
+        }
+    }
+
+    void Surface::Fill(const Color& color)
     {
-        m_color = (m_color & 0x00FFFFFFu) | (uint32_t(x) << 24);
+        if (m_clip.IsEmpty())
+            return;
+
+        kernels::FillRect(*this, m_clip, Pack(color));
+        Touch();
     }
-    void Color::SetR(uint8_t r) 
+
+    void Surface::Touch()
     {
-        m_color = (m_color & 0xFF00FFFFu) | (uint32_t(r) << 16);
+        if (m_buffer)
+            m_buffer->generation.fetch_add(1, std::memory_order_release);
     }
-    void Color::SetG(uint8_t g) 
+}
+
+
+// Class DisplayList
+namespace opus::gfx
+{
+    DisplayList::~DisplayList() = default;
+
+    // Recording
+    void DisplayList::Clear()
+    {
+        m_commands.clear();
+        m_text.clear();
+        m_layer = 0;
+    }
+
+    void DisplayList::SetLayer(uint16_t layer) { m_layer = layer; }
+
+    void DisplayList::Fill(const Rect& rect, const Color& color)
     {
-        m_color = (m_color & 0xFFFF00FFu) | (uint32_t(g) << 8);
+        DrawCommand command;
+        command.type = DrawCommand::Type::Fill;
+        command.color = color;
+        command.bounds = rect;
+        Push(command);
     }
-    void Color::SetB(uint8_t b) 
+
+    void DisplayList::Blit(const Surface& image, const Rect& frame, int32_t x, int32_t y, const BlitOptions& options)
     {
-        m_color = (m_color & 0xFFFFFF00u) | (uint32_t(b) << 0);
+        DrawCommand command;
+        command.type = DrawCommand::Type::Blit;
+        command.source = frame.Intersect(image.GetBounds());
+        command.bounds = Rect{x, y, command.source.w, command.source.h};
+        command.x = x;
+        command.y = y;
+        command.options = options;
+        command.object = &image;
+        Push(command);
     }
-    void Color::SetXRGB(uint8_t x, uint8_t r, uint8_t g, uint8_t b)
+
+    void DisplayList::Line(int32_t x0, int32_t y0, int32_t x1, int32_t y1, const Color& color)
     {
-        m_color = (uint32_t(x) << 24) |
-                  (uint32_t(r) << 16) |
-                  (uint32_t(g) << 8)  |
-                  (uint32_t(b) << 0);
+        DrawCommand command;
+        command.type = DrawCommand::Type::Line;
+        command.color = color;
+        command.bounds = Rect{std::min(x0, x1), std::min(y0, y1), std::abs(x1 - x0) + 1, std::abs(y1 - y0) + 1};
+        command.source = Rect{x1, y1, 0, 0};
+        command.x = x0;
+        command.y = y0;
+        Push(command);
     }
-    void Color::SetRGB(uint8_t r, uint8_t g, uint8_t b)
+
+    void DisplayList::Text(const Font& font, int32_t x, int32_t y, const char* text, size_t length)
     {
-        m_color = (m_color & 0xFF000000u) |
-                  (uint32_t(r) << 16) |
-                  (uint32_t(g) << 8)  |
-                  (uint32_t(b) << 0);
+        DrawCommand command;
+        command.type = DrawCommand::Type::Text;
+        command.bounds = Rect{x, y, int32_t(length * font.cellWidth), int32_t(font.cellHeight)};
+        command.x = x;
+        command.y = y;
+        command.options.mode = BlendMode::ColorKey;
+        command.options.key = font.key;
+        command.object = &font;
+        command.text = uint32_t(m_text.size());
+        command.length = uint32_t(length);
+        m_text.insert(m_text.end(), text, text + length);
+        Push(command);
     }
 
-    // Helpers
-    Color Color::FromXRGB(uint8_t x, uint8_t r, uint8_t g, uint8_t b)
+    void DisplayList::Draw(Drawable& drawable)
     {
-        Color c;
-        c.SetXRGB(x, r, g, b);
-        return c;
+        DrawCommand command;
+        command.type = DrawCommand::Type::Drawable;
+        command.bounds = drawable.GetBounds();
+        command.object = &drawable;
+        Push(command);
     }
-    Color Color::FromRGB(uint8_t r, uint8_t g, uint8_t b)
+
+    void DisplayList::Append(const DisplayList& other)
     {
-        return FromXRGB(0, r, g, b);
+        const uint32_t textBase = uint32_t(m_text.size());
+        m_text.insert(m_text.end(), other.m_text.begin(), other.m_text.end());
+
+        const size_t first = m_commands.size();
+        m_commands.insert(m_commands.end(), other.m_commands.begin(), other.m_commands.end());
+        for (size_t i = first; i < m_commands.size(); ++i)
+            m_commands[i].text += textBase;
     }
-}
 
-// Class PaletteXRGB
-namespace opus::gfx
-{
-        // Constructor and Destructor
-        Palette::Palette() : m_palette{}, m_numColors(0)
+    // Optimization
+    void DisplayList::Sort()
+    {
+        const bool sorted = std::is_sorted(m_commands.begin(), m_commands.end(),
+                                           [](const DrawCommand& a, const DrawCommand& b) { return a.layer < b.layer; });
+        if (sorted)
+            return;
+
+        RadixSort(m_commands, m_scratch, 16, [](const DrawCommand& command) { return command.layer; });
+    }
+
+    void DisplayList::Cull(const Rect& view)
+    {
+        size_t kept = 0;
+        for (DrawCommand& command : m_commands)
         {
+            const Rect visible = command.bounds.Intersect(view);
+            if (visible.IsEmpty())
+                continue;
+
+            command.bounds = visible;
+            m_commands[kept++] = command;
         }
-        Palette::~Palette()
+        m_commands.resize(kept);
+    }
+
+    void DisplayList::Merge()
+    {
+        constexpr size_t MAX_OCCLUDERS = 8; // Latest large fills; bounds the cost per command
+
+        // Back to front: anything entirely under a later fill never shows
+        std::array<Rect, MAX_OCCLUDERS> occluders;
+        size_t numOccluders = 0;
+        size_t kept = m_commands.size();
+        for (size_t i = m_commands.size(); i-- > 0;)
         {
-        };
+            const DrawCommand& command = m_commands[i];
+            const Rect& b = command.bounds;
 
-        // Getters
-        uint8_t Palette::GetNumColor()
+            bool hidden = false;
+            for (size_t k = 0; k < numOccluders && !hidden; ++k)
+                hidden = b.Intersect(occluders[k]).Area() == b.Area();
+            if (hidden)
+                continue;
+
+            // Keep the largest fills as occluders
+            if (command.type == DrawCommand::Type::Fill)
+            {
+                if (numOccluders < MAX_OCCLUDERS)
+                {
+                    occluders[numOccluders++] = b;
+                }
+                else
+                {
+                    Rect* smallest = std::min_element(occluders.begin(), occluders.end(),
+                                                      [](const Rect& x, const Rect& y) { return x.Area() < y.Area(); });
+                    if (smallest->Area() < b.Area())
+                        *smallest = b;
+                }
+            }
+            m_commands[--kept] = command;
+        }
+        m_commands.erase(m_commands.begin(), m_commands.begin() + ptrdiff_t(kept));
+
+        // Front to back: neighbouring same-colour fills that form a rect
+        size_t out = 0;
+        for (size_t i = 0; i < m_commands.size(); ++i)
         {
-            return m_numColors;
+            const DrawCommand& command = m_commands[i];
+            if (out > 0)
+            {
+                DrawCommand& last = m_commands[out - 1];
+                const Rect& a = last.bounds;
+                const Rect& b = command.bounds;
+                const bool fills = last.type == DrawCommand::Type::Fill && command.type == DrawCommand::Type::Fill &&
+                                   last.layer == command.layer && last.color.GetXRGB() == command.color.GetXRGB();
+                const bool stacked = a.x == b.x && a.w == b.w && (a.Bottom() == b.y || b.Bottom() == a.y);
+                const bool beside = a.y == b.y && a.h == b.h && (a.Right() == b.x || b.Right() == a.x);
+                if (fills && (stacked || beside))
+                {
+                    last.bounds = a.Union(b);
+                    continue;
+                }
+            }
+            m_commands[out++] = command;
         }
-        const Color& Palette::GetColor(uint8_t index) const 
+        m_commands.resize(out);
+    }
+
+    // Replay
+    void DisplayList::Replay(Surface& target) const
+    {
+        const Rect clip = target.GetClip();
+        for (const DrawCommand& command : m_commands)
         {
-            return m_palette[index];
+            if (command.bounds.Intersects(clip))
+                Execute(command, target);
         }
-        Color& Palette::GetColor(uint8_t index)
+    }
+
+    void DisplayList::Replay(const Surface& target, opus::jobs::JobPool& pool, uint32_t bands) const
+    {
+        const Rect clip = target.GetClip();
+        bands = std::max(1u, std::min(bands, uint32_t(std::max(clip.h, 1))));
+        const int32_t bandRows = (clip.h + int32_t(bands) - 1) / int32_t(bands);
+
+        // Each band writes only its own rows through its own view
+        pool.ParallelFor(bands, [&](uint32_t band)
         {
+            OPUS_PROFILE_SCOPE("DisplayList::Band");
+            Surface view = target;
+            view.SetClip(clip.Intersect(Rect{clip.x, clip.y + int32_t(band) * bandRows, clip.w, bandRows}));
+            if (!view.GetClip().IsEmpty())
+                Replay(view);
+        });
+    }
 
-        };
+    // Getters
+    const std::vector<DrawCommand>& DisplayList::GetCommands() const { return m_commands; }
+    bool DisplayList::IsEmpty() const { return m_commands.empty(); }
 
-        // Setters
-        
+    Rect DisplayList::GetBounds() const
+    {
+        Rect bounds;
+        for (const DrawCommand& command : m_commands)
+            bounds = bounds.Union(command.bounds);
+        return bounds;
     }
 
-// Class Surface
+    // Helpers
+    void DisplayList::Push(const DrawCommand& command)
+    {
+        if (command.bounds.IsEmpty())
+            return;
+
+        m_commands.push_back(command);
+        m_commands.back().layer = m_layer;
+    }
+
+    void DisplayList::Execute(const DrawCommand& command, Surface& view) const
+    {
+        switch (command.type)
+        {
+        case DrawCommand::Type::Fill:
+            kernels::FillRect(view, command.bounds, view.Pack(command.color));
+            break;
 
+        case DrawCommand::Type::Blit:
+            kernels::Blit(view, command.x, command.y, *static_cast<const Surface*>(command.object), command.source,
+                          command.options);
+            break;
+
+        case DrawCommand::Type::Line:
+            kernels::DrawLine(view, command.x, command.y, command.source.x, command.source.y, view.Pack(command.color));
+            break;
+
+        case DrawCommand::Type::Text:
+        {
+            const Font& font = *static_cast<const Font*>(command.object);
+            const int32_t cellW = int32_t(font.cellWidth);
+            const int32_t cellH = int32_t(font.cellHeight);
+            for (uint32_t i = 0; i < command.length; ++i)
+            {
+                const int32_t glyph = int32_t(uint8_t(m_text[command.text + i])) - ' ';
+                if (glyph <= 0 || glyph > '~' - ' ')
+                    continue; // Spaces and characters the font lacks
+
+                const Rect cell{(glyph % int32_t(Font::GLYPHS_PER_ROW)) * cellW,
+                                (glyph / int32_t(Font::GLYPHS_PER_ROW)) * cellH, cellW, cellH};
+                kernels::Blit(view, command.x + int32_t(i) * cellW, command.y, font.glyphs, cell, command.options);
+            }
+            break;
+        }
+
+        case DrawCommand::Type::Drawable:
+            static_cast<Drawable*>(const_cast<void*>(command.object))->Draw(view);
+            break;
+        }
+    }
+}
 
 // Class Drawable
 namespace opus::gfx
 {
-    // Constructor and Destructor
-    Drawable::Drawable()
-        : m_renderable(true)
+    Drawable::~Drawable()
     {
+        if (DrawableTask* parent = m_parent.load(std::memory_order_acquire))
+            parent->Forget(*this);
     }
-    Drawable::~Drawable()
+
+    bool Drawable::IsVisible() const { return m_visible; }
+    bool Drawable::IsDrawable() const { return m_renderable; }
+    bool Drawable::IsDirty() const { return m_dirty.load(std::memory_order_acquire); }
+    DrawableTask* Drawable::GetParent() const { return m_parent.load(std::memory_order_acquire); }
+
+    void Drawable::SetVisible(bool visible)
+    {
+        if (m_visible == visible)
+            return;
+
+        m_visible = visible;
+        MarkDirty();
+    }
+
+    void Drawable::SetLayer(uint16_t layer)
+    {
+        if (m_layer == layer)
+            return;
+
+        // The task re-sorts on its next pass; only our own area is redrawn
+        m_layer = layer;
+        MarkDirty();
+    }
+
+    uint16_t Drawable::GetLayer() const { return m_layer; }
+
+    void Drawable::MarkDirty()
+    {
+        if (m_dirty.exchange(true, std::memory_order_acq_rel))
+            return;
+
+        // The parent refiles and redraws only the drawables that changed. Tasks
+        // on workers may mark drawables of one parent at once, so this pushes
+        // onto a lock-free list the parent takes on its own thread.
+        DrawableTask* parent = m_parent.load(std::memory_order_acquire);
+        if (!parent || m_queued.exchange(true, std::memory_order_acq_rel))
+            return;
+
+        Drawable* head = parent->m_marked.load(std::memory_order_relaxed);
+        do
+        {
+            m_nextMarked = head;
+        } while (!parent->m_marked.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    Rect Drawable::GetBounds() const
+    {
+        return Rect{0, 0, INT32_MAX, INT32_MAX};
+    }
+
+    void Drawable::Prepare(const Surface& /*target*/) {}
+
+    bool Drawable::Record(DisplayList& /*list*/) { return false; }
+}
+
+// Class Sprite
+namespace opus::gfx
+{
+    Sprite::Sprite(const Surface& image) : m_image(image), m_frame(image.GetBounds()) {}
+
+    Sprite::~Sprite() = default;
+
+    const Surface& Sprite::GetImage() const { return m_image; }
+    const Rect& Sprite::GetFrame() const { return m_frame; }
+    int32_t Sprite::GetX() const { return m_x; }
+    int32_t Sprite::GetY() const { return m_y; }
+    const BlitOptions& Sprite::GetOptions() const { return m_options; }
+
+    void Sprite::SetImage(const Surface& image)
+    {
+        m_image = image;
+        m_frame = image.GetBounds();
+        MarkDirty();
+    }
+
+    void Sprite::SetFrame(const Rect& frame)
+    {
+        const Rect clipped = frame.Intersect(m_image.GetBounds());
+        if (clipped.x == m_frame.x && clipped.y == m_frame.y && clipped.w == m_frame.w && clipped.h == m_frame.h)
+            return;
+
+        m_frame = clipped;
+        MarkDirty();
+    }
+
+    void Sprite::SetPosition(int32_t x, int32_t y)
+    {
+        if (x == m_x && y == m_y)
+            return;
+
+        m_x = x;
+        m_y = y;
+        MarkDirty();
+    }
+
+    void Sprite::SetBlendMode(BlendMode mode)
+    {
+        if (mode == m_options.mode)
+            return;
+
+        m_options.mode = mode;
+        MarkDirty();
+    }
+
+    void Sprite::SetColorKey(const Color& key)
+    {
+        const uint32_t packed = m_image.Pack(key);
+        if (packed == m_options.key)
+            return;
+
+        m_options.key = packed;
+        if (m_options.mode == BlendMode::ColorKey)
+            MarkDirty();
+    }
+
+    void Sprite::SetFlip(bool flipX, bool flipY)
+    {
+        if (flipX == m_options.flipX && flipY == m_options.flipY)
+            return;
+
+        m_options.flipX = flipX;
+        m_options.flipY = flipY;
+        MarkDirty();
+    }
+
+    Rect Sprite::GetBounds() const
+    {
+        return Rect{m_x, m_y, m_frame.w, m_frame.h};
+    }
+
+    void Sprite::Draw(Surface& target)
+    {
+        kernels::Blit(target, m_x, m_y, m_image, m_frame, m_options);
+    }
+
+    bool Sprite::Record(DisplayList& list)
+    {
+        list.Blit(m_image, m_frame, m_x, m_y, m_options);
+        return true;
+    }
+}
+
+// Class TileMapLayer
+namespace opus::gfx
+{
+    TileMapLayer::~TileMapLayer() = default;
+
+    // Getters
+    const Surface& TileMapLayer::GetTileset() const { return m_tileset; }
+    uint32_t TileMapLayer::GetTileWidth() const { return m_tileWidth; }
+    uint32_t TileMapLayer::GetTileHeight() const { return m_tileHeight; }
+    uint32_t TileMapLayer::GetTileCount() const { return m_tileCount; }
+    uint32_t TileMapLayer::GetColumns() const { return m_columns; }
+    uint32_t TileMapLayer::GetRows() const { return m_rows; }
+    int32_t TileMapLayer::GetScrollX() const { return m_scrollX; }
+    int32_t TileMapLayer::GetScrollY() const { return m_scrollY; }
+    bool TileMapLayer::IsWrapping() const { return m_wrap; }
+
+    uint16_t TileMapLayer::GetTile(uint32_t column, uint32_t row) const
+    {
+        if (column >= m_columns || row >= m_rows)
+            return EMPTY_TILE;
+        return m_tiles[size_t(row) * m_columns + column];
+    }
+
+    // Setters
+    void TileMapLayer::SetTileset(const Surface& tileset, uint32_t tileWidth, uint32_t tileHeight)
+    {
+        m_tileset = tileset;
+        m_tileWidth = tileWidth;
+        m_tileHeight = tileHeight;
+        m_tileCount = (tileWidth && tileHeight) ? (tileset.GetWidth() / tileWidth) * (tileset.GetHeight() / tileHeight) : 0;
+        m_cacheValid = false;
+        MarkDirty();
+    }
+
+    void TileMapLayer::SetMapSize(uint32_t columns, uint32_t rows)
+    {
+        m_columns = columns;
+        m_rows = rows;
+        m_tiles.assign(size_t(columns) * rows, EMPTY_TILE);
+        MarkDirty();
+    }
+
+    void TileMapLayer::SetTile(uint32_t column, uint32_t row, uint16_t tile)
+    {
+        if (column >= m_columns || row >= m_rows)
+            return;
+
+        uint16_t& slot = m_tiles[size_t(row) * m_columns + column];
+        if (slot == tile)
+            return;
+
+        slot = tile;
+        MarkDirty();
+    }
+
+    void TileMapLayer::SetScroll(int32_t x, int32_t y)
+    {
+        if (x == m_scrollX && y == m_scrollY)
+            return;
+
+        m_scrollX = x;
+        m_scrollY = y;
+        MarkDirty();
+    }
+
+    void TileMapLayer::SetViewport(const Rect& viewport)
     {
+        m_viewport = viewport;
+        MarkDirty();
     }
 
-    bool Drawable::IsDrawable() { return m_renderable; }
+    void TileMapLayer::SetWrapping(bool wrap)
+    {
+        if (wrap == m_wrap)
+            return;
+
+        m_wrap = wrap;
+        MarkDirty();
+    }
+
+    Rect TileMapLayer::GetBounds() const
+    {
+        return m_viewport.IsEmpty() ? Drawable::GetBounds() : m_viewport;
+    }
+
+    void TileMapLayer::Prepare(const Surface& target)
+    {
+        UpdateCache(target.GetFormat());
+    }
+
+    void TileMapLayer::Draw(Surface& target)
+    {
+        const Rect viewport = m_viewport.IsEmpty() ? target.GetBounds() : m_viewport;
+        const Rect r = viewport.Intersect(target.GetClip());
+        if (r.IsEmpty() || m_tiles.empty() || !UpdateCache(target.GetFormat()))
+            return;
+
+        const int32_t tileW = int32_t(m_tileWidth);
+        const int32_t tileH = int32_t(m_tileHeight);
+        const int32_t mapW = int32_t(m_columns) * tileW;
+        const int32_t mapH = int32_t(m_rows) * tileH;
+        const uint32_t bpp = BytesPerPixel(target.GetFormat());
+
+        // Map coordinates of the first pixel drawn; wrapped into the map once
+        // here so the loops below only ever step forwards
+        int32_t mapLeft = r.x - viewport.x + m_scrollX;
+        int32_t mapY = r.y - viewport.y + m_scrollY;
+        if (m_wrap)
+        {
+            mapLeft = ((mapLeft % mapW) + mapW) % mapW;
+            mapY = ((mapY % mapH) + mapH) % mapH;
+        }
+
+        // Off the left of the map: start where it begins
+        const int32_t left = r.x + std::max(0, std::min(-mapLeft, r.w));
+        mapLeft = std::max(0, mapLeft);
+
+        const size_t targetPitch = target.GetPitch();
+        const size_t cachePitch = size_t(tileW) * bpp;
+
+        // Rows in the same row of tiles cross the same tiles, so walk the
+        // row once per band and copy the whole band under each tile
+        int32_t y = r.y;
+        while (y < r.Bottom())
+        {
+            if (m_wrap && mapY == mapH)
+                mapY = 0;
+            if (mapY < 0)
+            {
+                const int32_t skip = std::min(-mapY, r.Bottom() - y);
+                y += skip;
+                mapY += skip;
+                continue;
+            }
+            if (mapY >= mapH)
+                break;
+
+            const int32_t tileY = mapY % tileH;
+            const int32_t bandRows = std::min(tileH - tileY, r.Bottom() - y);
+            const uint16_t* tiles = m_tiles.data() + size_t(mapY / tileH) * m_columns;
+            uint8_t* band = target.GetRow(uint32_t(y));
+
+            // One run per tile; only the first starts mid-tile
+            int32_t x = left;
+            uint32_t column = uint32_t(mapLeft / tileW);
+            int32_t tileX = mapLeft % tileW;
+            while (x < r.Right())
+            {
+                if (column >= m_columns)
+                {
+                    if (!m_wrap)
+                        break;
+                    column = 0;
+                }
+
+                const int32_t run = std::min(tileW - tileX, r.Right() - x);
+                const uint16_t tile = tiles[column];
+                if (tile < m_tileCount)
+                {
+                    uint8_t* dst = band + size_t(x) * bpp;
+                    const uint8_t* src = GetCachedRow(tile, uint32_t(tileY)) + size_t(tileX) * bpp;
+                    for (int32_t i = 0; i < bandRows; ++i, dst += targetPitch, src += cachePitch)
+                        CopyRun(dst, src, size_t(run) * bpp);
+                }
+
+                x += run;
+                tileX = 0;
+                ++column;
+            }
+
+            y += bandRows;
+            mapY += bandRows;
+        }
+    }
+
+    // Helpers
+    bool TileMapLayer::UpdateCache(PixelFormat format)
+    {
+        if (m_tileCount == 0)
+            return false;
+
+        const uint64_t generation = m_tileset.GetGeneration();
+        if (m_cacheValid && m_cache.GetFormat() == format && m_cacheGeneration == generation)
+            return true;
+
+        const PixelFormat source = m_tileset.GetFormat();
+        if ((source == PixelFormat::Indexed8) != (format == PixelFormat::Indexed8))
+            return false;
+
+        OPUS_PROFILE_SCOPE("TileMapLayer::UpdateCache");
+
+        // One cache row per tile with the tile's rows packed end to end, so
+        // a tile is a single run of memory however the rows are padded
+        const size_t tileRow = size_t(m_tileWidth) * BytesPerPixel(format);
+        if (!m_cache.IsValid() || m_cache.GetFormat() != format || m_cache.GetWidth() != m_tileWidth * m_tileHeight ||
+            m_cache.GetHeight() != m_tileCount)
+        {
+            m_cache = Surface(m_tileWidth * m_tileHeight, m_tileCount, format);
+        }
+
+        const uint32_t tilesPerRow = m_tileset.GetWidth() / m_tileWidth;
+        for (uint32_t tile = 0; tile < m_tileCount; ++tile)
+        {
+            const Rect from{int32_t((tile % tilesPerRow) * m_tileWidth), int32_t((tile / tilesPerRow) * m_tileHeight),
+                            int32_t(m_tileWidth), int32_t(m_tileHeight)};
+            const Surface src = m_tileset.SubSurface(from);
+            const Surface dst = Surface::Wrap(m_cache.GetRow(tile), m_tileWidth, m_tileHeight, tileRow, format);
+
+            if (format == PixelFormat::Indexed8)
+            {
+                for (uint32_t y = 0; y < m_tileHeight; ++y)
+                    std::memcpy(dst.GetRow(y), src.GetRow(y), tileRow);
+            }
+            else
+            {
+                kernels::Convert(src, dst);
+            }
+        }
+
+        m_cacheGeneration = generation;
+        m_cacheValid = true;
+        return true;
+    }
+
+    const uint8_t* TileMapLayer::GetCachedRow(uint16_t tile, uint32_t y) const
+    {
+        return m_cache.GetRow(tile) + size_t(y) * m_tileWidth * BytesPerPixel(m_cache.GetFormat());
+    }
+}
+
+// Class StaticLayer
+namespace opus::gfx
+{
+    StaticLayer::~StaticLayer() = default;
+
+    DisplayList& StaticLayer::GetList() { return m_list; }
+    const DisplayList& StaticLayer::GetList() const { return m_list; }
+
+    Rect StaticLayer::GetBounds() const { return m_list.GetBounds(); }
+    void StaticLayer::Draw(Surface& target) { m_list.Replay(target); }
+
+    bool StaticLayer::Record(DisplayList& list)
+    {
+        list.Append(m_list);
+        return true;
+    }
 }
 
 // Class DrawableTask
 namespace opus::gfx
 {
-    
+    DrawableTask::~DrawableTask()
+    {
+        ApplyPending();
+        for (Drawable* d : m_drawables)
+        {
+            if (!d)
+                continue;
+
+            d->m_attached = false;
+            d->m_listed = false;
+            d->m_removing.store(false, std::memory_order_relaxed);
+            d->m_parent.store(nullptr, std::memory_order_release);
+        }
+    }
+
     bool DrawableTask::AddDrawable(Drawable& drawable)
     {
-        // prevent duplicates
-        auto it = std::find(m_drawables.begin(), m_drawables.end(), &drawable);
-        if (it != m_drawables.end())
+        // prevent duplicates (a drawable belongs to one task at a time). One
+        // that is ours may be added again while a Remove or Clear is queued:
+        // the Add cancels the Remove, and re-attaches it after the Clear.
+        DrawableTask* expected = nullptr;
+        if (!drawable.m_parent.compare_exchange_strong(expected, this, std::memory_order_acq_rel) &&
+            (expected != this || (!drawable.m_removing.exchange(false, std::memory_order_acq_rel) &&
+                                  m_clears.load(std::memory_order_acquire) == 0)))
             return false;
 
-        m_drawables.push_back(&drawable);
+        m_commands.Push(Command{Command::Type::Add, &drawable});
         return true;
     }
 
     bool DrawableTask::RemoveDrawable(Drawable& drawable)
     {
-        auto it = std::remove(m_drawables.begin(), m_drawables.end(), &drawable);
-        if (it == m_drawables.end())
+        if (drawable.m_parent.load(std::memory_order_acquire) != this)
             return false;
 
-        m_drawables.erase(it, m_drawables.end());
+        drawable.m_removing.store(true, std::memory_order_release);
+        m_commands.Push(Command{Command::Type::Remove, &drawable});
         return true;
     }
 
     bool DrawableTask::Clear()
     {
-        m_drawables.clear();
+        m_clears.fetch_add(1, std::memory_order_acq_rel);
+        m_commands.Push(Command{Command::Type::Clear, nullptr});
         return true;
     }
 
+    void DrawableTask::ApplyPending()
+    {
+        if (m_hasHoles && !m_drawing)
+        {
+            m_drawables.erase(std::remove(m_drawables.begin(), m_drawables.end(), nullptr), m_drawables.end());
+            for (size_t i = 0; i < m_drawables.size(); ++i)
+                m_drawables[i]->m_index = uint32_t(i);
+            m_hasHoles = false;
+        }
+
+        // Before the commands: a drawable marked ahead of its Add is listed by Attach
+        TakeMarked();
+
+        if (m_commands.IsEmpty())
+            return;
+
+        m_commands.Drain([this](Command&& command)
+        {
+            switch (command.type)
+            {
+            case Command::Type::Add:
+                Attach(*command.drawable);
+                break;
+            case Command::Type::Remove:
+                if (command.drawable->m_removing.exchange(false, std::memory_order_acq_rel))
+                    Detach(*command.drawable); // Not cancelled by a later Add
+                break;
+            case Command::Type::Clear:
+                // By index: during a pass Detach leaves holes rather than erasing
+                for (size_t i = m_drawables.size(); i-- > 0;)
+                {
+                    if (Drawable* d = m_drawables[i])
+                        Detach(*d);
+                }
+                m_clears.fetch_sub(1, std::memory_order_acq_rel);
+                break;
+            }
+        });
+    }
+
+    void DrawableTask::SetTarget(const Surface& target)
+    {
+        // Another buffer holds unknown pixels; the same one keeps the last frame
+        if (target.GetData() != m_target.GetData() || target.GetPitch() != m_target.GetPitch() ||
+            target.GetWidth() != m_target.GetWidth() || target.GetHeight() != m_target.GetHeight())
+            m_dirty = true;
+
+        m_target = target;
+    }
+
+    const Surface& DrawableTask::GetTarget() const { return m_target; }
+
+    void DrawableTask::SetClearColor(const Color& color)
+    {
+        m_clearColor = color;
+        m_clear = true;
+        m_dirty = true;
+    }
+
+    void DrawableTask::Invalidate() { m_dirty = true; }
+
+    void DrawableTask::SetJobPool(opus::jobs::JobPool* pool) { m_pool = pool; }
+    void DrawableTask::SetBandCount(uint32_t bands) { m_bandCount = bands; }
+
+    void DrawableTask::SetRecording(bool recording)
+    {
+        m_recording = recording;
+        m_list.Clear();
+    }
+
+    const DisplayList& DrawableTask::GetDisplayList() const { return m_list; }
+
+    uint32_t DrawableTask::GetBandCount() const
+    {
+        if (!m_pool || !m_target.IsValid())
+            return 1;
+
+        // Several bands per thread, so stealing evens out crowded bands
+        const uint32_t maxBands = std::max(1u, m_target.GetHeight() / MIN_BAND_ROWS);
+        if (m_bandCount)
+            return std::min(m_bandCount, maxBands);
+        if (m_pool->NumWorkers() == 0)
+            return 1;
+        return std::min((m_pool->NumWorkers() + 1) * 4, maxBands);
+    }
+
+    const std::vector<Rect>& DrawableTask::GetDirtyRects() const { return m_dirtyRects; }
+
+    bool DrawableTask::IsDirty() const
+    {
+        // Someone else wrote to the target since we drew
+        return m_dirty || !m_commands.IsEmpty() || m_target.GetGeneration() != m_drawnGeneration ||
+               !m_exposed.empty() || !m_changed.empty() || m_marked.load(std::memory_order_acquire);
+    }
+
+    void DrawableTask::Attach(Drawable& drawable)
+    {
+        if (drawable.m_attached)
+            return;
+
+        // Added again after a Clear detached it; unless another task took it since
+        DrawableTask* expected = nullptr;
+        if (drawable.m_parent.load(std::memory_order_acquire) != this &&
+            !drawable.m_parent.compare_exchange_strong(expected, this, std::memory_order_acq_rel))
+            return;
+
+        drawable.m_attached = true;
+        drawable.m_dirty.store(true, std::memory_order_relaxed);
+        drawable.m_drawnBounds = Rect{};
+        drawable.m_index = uint32_t(m_drawables.size());
+        drawable.m_visited = m_pass; // Another task's pass count may be ahead
+        m_drawables.push_back(&drawable);
+        if (!drawable.m_listed)
+        {
+            drawable.m_listed = true;
+            m_changed.push_back(&drawable);
+        }
+    }
+
+    void DrawableTask::Detach(Drawable& drawable)
+    {
+        if (!drawable.m_attached)
+            return;
+
+        // It may still be on the marked list; bring that into m_changed first
+        TakeMarked();
+
+        if (m_drawing)
+        {
+            m_drawables[drawable.m_index] = nullptr;
+            m_hasHoles = true;
+        }
+        else
+        {
+            m_drawables.erase(m_drawables.begin() + ptrdiff_t(drawable.m_index));
+            for (size_t i = drawable.m_index; i < m_drawables.size(); ++i)
+                m_drawables[i]->m_index = uint32_t(i);
+        }
+
+        // Searched from the back, so clearing a freshly filled task stays linear
+        if (drawable.m_listed)
+        {
+            drawable.m_listed = false;
+            auto it = std::find(m_changed.rbegin(), m_changed.rend(), &drawable);
+            if (it != m_changed.rend())
+            {
+                if (m_drawing)
+                    *it = nullptr;
+                else
+                    m_changed.erase(std::next(it).base());
+            }
+        }
+
+        // Its pixels are still on the target
+        Expose(drawable.m_drawnBounds);
+        Unfile(drawable);
+        drawable.m_drawnBounds = Rect{};
+
+        // Last: from here the drawable may be destroyed on another thread
+        drawable.m_attached = false;
+        drawable.m_parent.store(nullptr, std::memory_order_release);
+    }
+
+    void DrawableTask::Forget(Drawable& drawable)
+    {
+        // Settle queued commands that may still name the drawable, then drop it
+        ApplyPending();
+        Detach(drawable);
+        drawable.m_removing.store(false, std::memory_order_relaxed);
+        drawable.m_parent.store(nullptr, std::memory_order_release);
+    }
+
+    void DrawableTask::TakeMarked()
+    {
+        // Take the whole list at once, then reverse it into marking order
+        Drawable* node = m_marked.exchange(nullptr, std::memory_order_acquire);
+        Drawable* fifo = nullptr;
+        while (node)
+        {
+            Drawable* next = node->m_nextMarked;
+            node->m_nextMarked = fifo;
+            fifo = node;
+            node = next;
+        }
+
+        while (fifo)
+        {
+            // Read the link before the drawable can be marked onto a list again
+            Drawable* d = fifo;
+            fifo = d->m_nextMarked;
+            d->m_queued.store(false, std::memory_order_release);
+
+            // Not ours yet: Attach lists it
+            if (d->m_attached && d->m_parent.load(std::memory_order_relaxed) == this && !d->m_listed)
+            {
+                d->m_listed = true;
+                m_changed.push_back(d);
+            }
+        }
+    }
+
+    void DrawableTask::Expose(const Rect& rect)
+    {
+        // Off-target areas need no redraw; a new target is redrawn whole
+        if (rect.Intersects(m_target.GetBounds()))
+            m_exposed.push_back(rect);
+    }
+
+    void DrawableTask::File(Drawable& drawable)
+    {
+        const Rect& bounds = drawable.m_drawnBounds;
+        if (bounds.IsEmpty())
+            return;
+
+        const CellRange cells = CellsOf(bounds, CELL_SHIFT);
+        if (cells.Count() > MAX_FILED_CELLS)
+        {
+            m_large.push_back(&drawable);
+            return;
+        }
+
+        if (m_grid.empty())
+            m_grid.resize(GRID_BUCKETS);
+        for (int64_t cy = cells.y0; cy <= cells.y1; ++cy)
+        {
+            for (int64_t cx = cells.x0; cx <= cells.x1; ++cx)
+                m_grid[CellBucket(cx, cy, GRID_BUCKETS)].push_back(&drawable);
+        }
+    }
+
+    void DrawableTask::Unfile(Drawable& drawable)
+    {
+        const Rect& bounds = drawable.m_drawnBounds;
+        if (bounds.IsEmpty())
+            return;
+
+        // One entry per covered cell, so cells sharing a bucket each drop one
+        const auto drop = [&drawable](std::vector<Drawable*>& entries)
+        {
+            auto it = std::find(entries.begin(), entries.end(), &drawable);
+            if (it == entries.end())
+                return;
+            *it = entries.back();
+            entries.pop_back();
+        };
+
+        const CellRange cells = CellsOf(bounds, CELL_SHIFT);
+        if (cells.Count() > MAX_FILED_CELLS)
+        {
+            drop(m_large);
+            return;
+        }
+
+        for (int64_t cy = cells.y0; cy <= cells.y1; ++cy)
+        {
+            for (int64_t cx = cells.x0; cx <= cells.x1; ++cx)
+                drop(m_grid[CellBucket(cx, cy, GRID_BUCKETS)]);
+        }
+    }
+
+    void DrawableTask::CollectDirtyRects()
+    {
+        const Rect bounds = m_target.GetBounds();
+        m_dirtyRects.clear();
+
+        // Unknown target contents: everything
+        if (m_dirty || m_target.GetGeneration() != m_drawnGeneration)
+        {
+            m_dirtyRects.push_back(bounds);
+            m_exposed.clear();
+            return;
+        }
+
+        for (const Rect& rect : m_exposed)
+            AddDirtyRect(m_dirtyRects, rect.Intersect(bounds));
+        m_exposed.clear();
+
+        // Where a dirty drawable was and where it is now
+        for (const Drawable* d : m_changed)
+        {
+            if (!d)
+                continue;
+
+            AddDirtyRect(m_dirtyRects, d->m_drawnBounds.Intersect(bounds));
+            if (d->m_visible && d->m_renderable)
+                AddDirtyRect(m_dirtyRects, d->GetBounds().Intersect(bounds));
+        }
+
+        // Keep the pass count bounded: merge the cheapest pairs
+        while (m_dirtyRects.size() > MAX_DIRTY_RECTS)
+        {
+            size_t bestA = 0;
+            size_t bestB = 1;
+            int64_t bestCost = INT64_MAX;
+            for (size_t a = 0; a < m_dirtyRects.size(); ++a)
+            {
+                for (size_t b = a + 1; b < m_dirtyRects.size(); ++b)
+                {
+                    const int64_t cost = MergeCost(m_dirtyRects[a], m_dirtyRects[b]);
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestA = a;
+                        bestB = b;
+                    }
+                }
+            }
+
+            const Rect merged = m_dirtyRects[bestA].Union(m_dirtyRects[bestB]);
+            m_dirtyRects.erase(m_dirtyRects.begin() + ptrdiff_t(bestB));
+            m_dirtyRects.erase(m_dirtyRects.begin() + ptrdiff_t(bestA));
+            AddDirtyRect(m_dirtyRects, merged);
+        }
+    }
+
+    void DrawableTask::Gather()
+    {
+        // Visit only the cells under the dirty regions; a drawable filed in
+        // several of them is taken once per pass
+        ++m_pass;
+        m_order.clear();
+        for (const Rect& region : m_dirtyRects)
+        {
+            if (m_grid.empty())
+                break;
+
+            const CellRange cells = CellsOf(region, CELL_SHIFT);
+            for (int64_t cy = cells.y0; cy <= cells.y1; ++cy)
+            {
+                for (int64_t cx = cells.x0; cx <= cells.x1; ++cx)
+                {
+                    for (Drawable* d : m_grid[CellBucket(cx, cy, GRID_BUCKETS)])
+                    {
+                        if (d->m_visited == m_pass || !d->m_drawnBounds.Intersects(region))
+                            continue;
+
+                        d->m_visited = m_pass;
+                        m_order.push_back(d->m_index);
+                    }
+                }
+            }
+        }
+
+        for (Drawable* d : m_large)
+        {
+            for (const Rect& region : m_dirtyRects)
+            {
+                if (d->m_drawnBounds.Intersects(region))
+                {
+                    m_order.push_back(d->m_index);
+                    break;
+                }
+            }
+        }
+
+        // Buckets come in no particular order: sort by layer, then by list
+        // position, with one linear pass per key byte
+        const uint32_t indexBits = uint32_t(std::bit_width(m_drawables.size()));
+        RadixSort(m_order, m_orderScratch, indexBits + 16, [this, indexBits](uint32_t i)
+        {
+            return (uint64_t(m_drawables[i]->m_layer) << indexBits) | i;
+        });
+    }
+
+    void DrawableTask::DrawRegion(Surface& view, const Rect& region, const std::vector<uint32_t>& drawables)
+    {
+        if (region.IsEmpty())
+            return;
+
+        view.SetClip(region);
+        if (m_clear)
+            kernels::FillRect(view, region, view.Pack(m_clearColor));
+
+        if (m_recording)
+        {
+            m_list.Replay(view);
+            return;
+        }
+
+        for (uint32_t k : drawables)
+        {
+            Drawable* d = m_drawables[m_order[k]];
+            if (!d || !m_bounds[k].Intersects(region))
+                continue;
+
+            OPUS_PROFILE_SCOPE("Drawable::Draw");
+            d->Draw(view);
+        }
+    }
+
     void DrawableTask::OnUpdate(uint64_t /*count*/)
     {
-        // Draw in the order they were added
-        for (auto* d : m_drawables)
+        // Safe point for queued registrations
+        ApplyPending();
+
+        if (!m_target.IsValid() || !IsDirty())
+        {
+            m_dirtyRects.clear();
+            return;
+        }
+
+        CollectDirtyRects();
+
+        // Refile what changed. Clean again from here: a change made during the
+        // pass marks the drawable anew and is drawn by the next one.
+        m_drawing = true;
+        const size_t changed = m_changed.size();
+        for (size_t i = 0; i < changed; ++i)
         {
+            Drawable* d = m_changed[i];
             if (!d)
                 continue;
 
-            // Your current API names it IsDrawable(); use it as a visibility gate.
-            if (!d->IsDrawable())
+            d->m_listed = false;
+            d->m_dirty.store(false, std::memory_order_release);
+            Unfile(*d);
+            d->m_drawnBounds = (d->IsVisible() && d->IsDrawable()) ? d->GetBounds() : Rect{};
+            File(*d);
+        }
+
+        int64_t dirtyPixels = 0;
+        for (const Rect& region : m_dirtyRects)
+            dirtyPixels += region.Area();
+
+        const uint32_t bands = dirtyPixels < MIN_BANDED_PIXELS ? 1 : GetBandCount();
+        const int32_t bandRows = int32_t((m_target.GetHeight() + bands - 1) / bands);
+        const Rect targetBounds = m_target.GetBounds();
+
+        // Bin the drawables by band on this thread, in layer order, so bands
+        // only visit what can reach them and never call GetBounds() or
+        // Prepare(). Indices, because a drawable that is destroyed mid-pass
+        // leaves a hole and one that is added is appended.
+        Gather();
+        m_bounds.assign(m_order.size(), Rect{});
+        m_list.Clear();
+        m_bands.resize(bands);
+        for (std::vector<uint32_t>& band : m_bands)
+            band.clear();
+
+        for (size_t k = 0; k < m_order.size(); ++k)
+        {
+            Drawable* d = m_drawables[m_order[k]];
+            if (!d || !d->IsVisible() || !d->IsDrawable())
+                continue;
+
+            const Rect b = d->m_drawnBounds.Intersect(targetBounds);
+            if (b.IsEmpty())
                 continue;
+
+            d->Prepare(m_target);
+            m_bounds[k] = b;
+            if (m_recording)
+            {
+                m_list.SetLayer(d->GetLayer());
+                if (!d->Record(m_list))
+                    m_list.Draw(*d);
+                continue;
+            }
+
+            for (int32_t band = b.y / bandRows; band <= (b.Bottom() - 1) / bandRows; ++band)
+                m_bands[size_t(band)].push_back(uint32_t(k));
+        }
+
+        // Already in layer order; sorting the list would move commands that
+        // a drawable appended with layers of their own
+        if (m_recording)
+        {
+            m_list.Cull(targetBounds);
+            m_list.Merge();
         }
+
+        if (bands == 1)
+        {
+            for (const Rect& region : m_dirtyRects)
+                DrawRegion(m_target, region, m_bands[0]);
+        }
+        else
+        {
+            // Bands share the pixels but never a row, so nothing is locked
+            m_pool->ParallelFor(bands, [&](uint32_t band)
+            {
+                OPUS_PROFILE_SCOPE("DrawableTask::Band");
+                const Rect rows{0, int32_t(band) * bandRows, targetBounds.w, bandRows};
+                Surface view = m_target;
+                for (const Rect& region : m_dirtyRects)
+                    DrawRegion(view, region.Intersect(rows), m_bands[band]);
+            });
+        }
+
+        m_target.SetClip(targetBounds);
+
+        m_changed.erase(m_changed.begin(), m_changed.begin() + ptrdiff_t(changed));
+        m_changed.erase(std::remove(m_changed.begin(), m_changed.end(), nullptr), m_changed.end());
+
+        m_drawing = false;
+        m_dirty = false;
+        m_target.Touch();
+        m_drawnGeneration = m_target.GetGeneration();
     }
 }
-
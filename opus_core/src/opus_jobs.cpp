@@ -0,0 +1,224 @@
+#include "opus_jobs.h"
+
+namespace
+{
+    // Identifies the pool (and queue) owned by the current worker thread.
+    thread_local opus::jobs::JobPool* t_pool = nullptr;
+    thread_local uint32_t t_worker = 0;
+}
+
+// Class JobPool
+namespace opus::jobs
+{
+    // Constructor and Destructor
+    JobPool::JobPool(uint32_t numWorkers)
+    {
+        m_queues.reserve(numWorkers);
+        for (uint32_t i = 0; i < numWorkers; ++i)
+            m_queues.push_back(std::make_unique<Queue>());
+
+        m_workers.reserve(numWorkers);
+        for (uint32_t i = 0; i < numWorkers; ++i)
+            m_workers.emplace_back(&JobPool::WorkerLoop, this, i);
+    }
+
+    JobPool::~JobPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+
+        for (std::thread& worker : m_workers)
+            worker.join();
+    }
+
+    // Control
+    void JobPool::Run(uint32_t count, Kernel kernel, void* context)
+    {
+        if (count == 0)
+            return;
+
+        // Nothing to share the work with
+        if (m_workers.empty() || count == 1)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+                kernel(context, i);
+            return;
+        }
+
+        // A few jobs per thread so that stealing can even out uneven work
+        const uint32_t numQueues = uint32_t(m_queues.size());
+        const uint32_t threads = numQueues + 1;
+        const uint32_t grain = std::max(1u, count / (threads * 4));
+        const uint32_t numJobs = (count + grain - 1) / grain;
+
+        Batch batch{kernel, context, {numJobs}};
+
+        const bool isWorker = (t_pool == this);
+        const uint32_t home = isWorker ? t_worker : (m_nextQueue.fetch_add(1, std::memory_order_relaxed) % numQueues);
+
+        for (uint32_t j = 0; j < numJobs; ++j)
+        {
+            const uint32_t begin = j * grain;
+            const uint32_t end = std::min(count, begin + grain);
+            const Job job{&batch, begin, end};
+            if (!Push((home + j) % numQueues, job))
+                Execute(job); // Ring full (deeply nested batches): no room to share it
+        }
+
+        {
+            // Pairs with the predicate check in WorkerLoop so no wake-up is lost
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_wake.notify_all();
+
+        // Help until every job of this batch is done
+        while (batch.pending.load(std::memory_order_acquire) != 0)
+        {
+            Job job;
+            if ((isWorker && Pop(t_worker, job)) || Steal(isWorker ? t_worker : home, job))
+                Execute(job);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void JobPool::NextFrame()
+    {
+        m_frame.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // State
+    uint32_t JobPool::NumWorkers() const
+    {
+        return uint32_t(m_workers.size());
+    }
+
+    // Helpers
+    uint32_t JobPool::DefaultWorkerCount()
+    {
+        const uint32_t hw = std::thread::hardware_concurrency();
+        return hw > 1 ? hw - 1 : 0;
+    }
+
+    // Internals
+    JobPool::Queue::Queue()
+    {
+        for (uint32_t i = 0; i < CAPACITY; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool JobPool::Push(uint32_t queue, const Job& job)
+    {
+        Queue& q = *m_queues[queue];
+        uint32_t pos = q.pushPos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Queue::Cell& cell = q.cells[pos & (Queue::CAPACITY - 1)];
+            const int32_t diff = int32_t(cell.sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0)
+            {
+                if (q.pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.job = job;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    m_queued.fetch_add(1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // A lap behind: full
+            }
+            else
+            {
+                pos = q.pushPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool JobPool::Take(Queue& q, Job& job)
+    {
+        uint32_t pos = q.takePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Queue::Cell& cell = q.cells[pos & (Queue::CAPACITY - 1)];
+            const int32_t diff = int32_t(cell.sequence.load(std::memory_order_acquire) - (pos + 1));
+            if (diff == 0)
+            {
+                if (q.takePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    job = cell.job;
+                    cell.sequence.store(pos + Queue::CAPACITY, std::memory_order_release);
+                    m_queued.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // Empty
+            }
+            else
+            {
+                pos = q.takePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool JobPool::Pop(uint32_t queue, Job& job)
+    {
+        return Take(*m_queues[queue], job);
+    }
+
+    bool JobPool::Steal(uint32_t thief, Job& job)
+    {
+        const uint32_t numQueues = uint32_t(m_queues.size());
+        for (uint32_t k = 1; k <= numQueues; ++k)
+        {
+            if (Take(*m_queues[(thief + k) % numQueues], job))
+                return true;
+        }
+        return false;
+    }
+
+    void JobPool::Execute(const Job& job)
+    {
+        Batch* batch = job.batch;
+        for (uint32_t i = job.begin; i < job.end; ++i)
+            batch->kernel(batch->context, i);
+
+        batch->pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void JobPool::WorkerLoop(uint32_t worker)
+    {
+        t_pool = this;
+        t_worker = worker;
+        uint64_t frame = m_frame.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            Job job;
+            if (Pop(worker, job) || Steal(worker, job))
+            {
+                // Between jobs nothing holds scratch from the arena
+                const uint64_t now = m_frame.load(std::memory_order_relaxed);
+                if (now != frame)
+                {
+                    opus::memory::GetFrameArena().Reset();
+                    frame = now;
+                }
+
+                Execute(job);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [this] { return m_stop || m_queued.load(std::memory_order_acquire) > 0; });
+            if (m_stop && m_queued.load(std::memory_order_acquire) == 0)
+                return;
+        }
+    }
+}
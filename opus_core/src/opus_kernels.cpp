@@ -0,0 +1,864 @@
+#include "opus_kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OPUS_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define OPUS_KERNELS_X86 0
+#endif
+
+// MSVC emits any intrinsic without per-function flags
+#if OPUS_KERNELS_X86 && defined(__GNUC__)
+#define OPUS_TARGET_SSE2 __attribute__((target("sse2")))
+#define OPUS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define OPUS_TARGET_SSE2
+#define OPUS_TARGET_AVX2
+#endif
+
+namespace
+{
+    using opus::gfx::kernels::Isa;
+
+    // Fills bytes at dst with a pattern that repeats every 4 bytes. dst is
+    // aligned to the pixel size, and patterns repeat the pixel (twice for
+    // 16 bpp, four times for 8 bpp), so a head up to 4-byte alignment reads
+    // the same wherever it starts.
+    using FillFn = void (*)(uint8_t* dst, size_t bytes, uint32_t pattern);
+
+    // Expands a row of palette indices through a pre-converted table
+    using Expand16Fn = void (*)(uint16_t* dst, const uint8_t* src, size_t count, const uint16_t* lut);
+    using Expand32Fn = void (*)(uint32_t* dst, const uint8_t* src, size_t count, const uint32_t* lut);
+
+    // Sprite rows. Reversed rows read src backwards from its last pixel, so a
+    // flipped span covers the same memory as the unflipped one.
+    using ReverseFn = void (*)(uint8_t* dst, const uint8_t* src, size_t count);
+    using KeyFn = void (*)(uint8_t* dst, const uint8_t* src, size_t count, uint32_t key);
+    using BlendFn = void (*)(uint32_t* dst, const uint32_t* src, size_t count);
+
+    void FillScalar(uint8_t* dst, size_t bytes, uint32_t pattern)
+    {
+        const uint16_t half = uint16_t(pattern);
+        if ((reinterpret_cast<uintptr_t>(dst) & 1) && bytes >= 1)
+        {
+            *dst++ = uint8_t(pattern);
+            --bytes;
+        }
+        if ((reinterpret_cast<uintptr_t>(dst) & 2) && bytes >= 2)
+        {
+            std::memcpy(dst, &half, 2);
+            dst += 2;
+            bytes -= 2;
+        }
+
+        const uint64_t wide = uint64_t(pattern) | (uint64_t(pattern) << 32);
+        for (; bytes >= 8; dst += 8, bytes -= 8)
+            std::memcpy(dst, &wide, 8);
+
+        if (bytes >= 4)
+        {
+            std::memcpy(dst, &pattern, 4);
+            dst += 4;
+            bytes -= 4;
+        }
+        if (bytes >= 2)
+        {
+            std::memcpy(dst, &half, 2);
+            dst += 2;
+            bytes -= 2;
+        }
+        if (bytes >= 1)
+            *dst = uint8_t(pattern);
+    }
+
+    void Expand16Scalar(uint16_t* dst, const uint8_t* src, size_t count, const uint16_t* lut)
+    {
+        for (size_t i = 0; i < count; ++i)
+            dst[i] = lut[src[i]];
+    }
+
+    void Expand32Scalar(uint32_t* dst, const uint8_t* src, size_t count, const uint32_t* lut)
+    {
+        for (size_t i = 0; i < count; ++i)
+            dst[i] = lut[src[i]];
+    }
+
+    template <typename T>
+    void ReverseScalar(uint8_t* dstBytes, const uint8_t* srcBytes, size_t count)
+    {
+        T* dst = reinterpret_cast<T*>(dstBytes);
+        const T* src = reinterpret_cast<const T*>(srcBytes);
+        for (size_t i = 0; i < count; ++i)
+            dst[i] = src[count - 1 - i];
+    }
+
+    template <typename T>
+    void KeyScalar(uint8_t* dstBytes, const uint8_t* srcBytes, size_t count, uint32_t key)
+    {
+        T* dst = reinterpret_cast<T*>(dstBytes);
+        const T* src = reinterpret_cast<const T*>(srcBytes);
+        const T k = T(key);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (src[i] != k)
+                dst[i] = src[i];
+        }
+    }
+
+    // round((s * a + d * (255 - a)) / 255); the sum fits in 16 bits, which
+    // the vector paths rely on
+    inline uint32_t BlendChannel(uint32_t s, uint32_t d, uint32_t a)
+    {
+        const uint32_t v = s * a + d * (255 - a) + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    // Source alpha is its top byte; the destination keeps its own
+    void BlendScalar(uint32_t* dst, const uint32_t* src, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint32_t s = src[i];
+            const uint32_t a = s >> 24;
+            if (a == 0)
+                continue;
+
+            const uint32_t d = dst[i];
+            if (a == 255)
+            {
+                dst[i] = (s & 0x00FFFFFFu) | (d & 0xFF000000u);
+                continue;
+            }
+
+            dst[i] = (d & 0xFF000000u) | (BlendChannel((s >> 16) & 0xFFu, (d >> 16) & 0xFFu, a) << 16) |
+                     (BlendChannel((s >> 8) & 0xFFu, (d >> 8) & 0xFFu, a) << 8) | BlendChannel(s & 0xFFu, d & 0xFFu, a);
+        }
+    }
+
+#if OPUS_KERNELS_X86
+    OPUS_TARGET_SSE2 void FillSSE2(uint8_t* dst, size_t bytes, uint32_t pattern)
+    {
+        // Short runs (narrow tiles, clipped edges) are not worth the set-up
+        if (bytes < 64)
+        {
+            FillScalar(dst, bytes, pattern);
+            return;
+        }
+
+        // Scalar head up to a 16-byte boundary, aligned stores, scalar tail
+        const size_t head = std::min(bytes, (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15);
+        FillScalar(dst, head, pattern);
+        dst += head;
+        bytes -= head;
+
+        const __m128i v = _mm_set1_epi32(int32_t(pattern));
+        for (; bytes >= 64; dst += 64, bytes -= 64)
+        {
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst + 0), v);
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst + 16), v);
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst + 32), v);
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst + 48), v);
+        }
+        for (; bytes >= 16; dst += 16, bytes -= 16)
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst), v);
+
+        FillScalar(dst, bytes, pattern);
+    }
+
+    OPUS_TARGET_AVX2 void FillAVX2(uint8_t* dst, size_t bytes, uint32_t pattern)
+    {
+        if (bytes < 64)
+        {
+            FillScalar(dst, bytes, pattern);
+            return;
+        }
+
+        const size_t head = std::min(bytes, (32 - (reinterpret_cast<uintptr_t>(dst) & 31)) & 31);
+        FillScalar(dst, head, pattern);
+        dst += head;
+        bytes -= head;
+
+        const __m256i v = _mm256_set1_epi32(int32_t(pattern));
+        for (; bytes >= 128; dst += 128, bytes -= 128)
+        {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(dst + 0), v);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(dst + 32), v);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(dst + 64), v);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(dst + 96), v);
+        }
+        for (; bytes >= 32; dst += 32, bytes -= 32)
+            _mm256_store_si256(reinterpret_cast<__m256i*>(dst), v);
+
+        FillScalar(dst, bytes, pattern);
+    }
+
+    // 16-bit gathers read 4 bytes per lane, so lut needs one spare entry
+    OPUS_TARGET_AVX2 void Expand16AVX2(uint16_t* dst, const uint8_t* src, size_t count, const uint16_t* lut)
+    {
+        const int* table = reinterpret_cast<const int*>(lut);
+        const __m256i low = _mm256_set1_epi32(0xFFFF);
+
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const __m256i a = _mm256_and_si256(_mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(indices), 2), low);
+            const __m256i b = _mm256_and_si256(
+                _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(indices, 8)), 2), low);
+
+            // packus interleaves 128-bit lanes; put the quarters back in order
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+        }
+
+        Expand16Scalar(dst + i, src + i, count - i, lut);
+    }
+
+    OPUS_TARGET_AVX2 void Expand32AVX2(uint32_t* dst, const uint8_t* src, size_t count, const uint32_t* lut)
+    {
+        const int* table = reinterpret_cast<const int*>(lut);
+
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const __m256i a = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(indices), 4);
+            const __m256i b = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(indices, 8)), 4);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), a);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 8), b);
+        }
+
+        Expand32Scalar(dst + i, src + i, count - i, lut);
+    }
+
+    // Reversal is bound by memory, so SSE2 serves AVX2 as well
+    template <typename T>
+    OPUS_TARGET_SSE2 void ReverseSSE2(uint8_t* dstBytes, const uint8_t* srcBytes, size_t count)
+    {
+        constexpr size_t lanes = 16 / sizeof(T);
+        T* dst = reinterpret_cast<T*>(dstBytes);
+        const T* src = reinterpret_cast<const T*>(srcBytes);
+
+        size_t i = 0;
+        for (; i + lanes <= count; i += lanes)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + count - i - lanes));
+            if constexpr (sizeof(T) == 4)
+            {
+                v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+            }
+            else
+            {
+                v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                v = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+                if constexpr (sizeof(T) == 1)
+                    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+        }
+
+        for (; i < count; ++i)
+            dst[i] = src[count - 1 - i];
+    }
+
+    template <typename T>
+    OPUS_TARGET_SSE2 void KeySSE2(uint8_t* dstBytes, const uint8_t* srcBytes, size_t count, uint32_t key)
+    {
+        constexpr size_t lanes = 16 / sizeof(T);
+        T* dst = reinterpret_cast<T*>(dstBytes);
+        const T* src = reinterpret_cast<const T*>(srcBytes);
+
+        __m128i k;
+        if constexpr (sizeof(T) == 1)
+            k = _mm_set1_epi8(char(key));
+        else if constexpr (sizeof(T) == 2)
+            k = _mm_set1_epi16(int16_t(key));
+        else
+            k = _mm_set1_epi32(int32_t(key));
+
+        size_t i = 0;
+        for (; i + lanes <= count; i += lanes)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i keyed;
+            if constexpr (sizeof(T) == 1)
+                keyed = _mm_cmpeq_epi8(v, k);
+            else if constexpr (sizeof(T) == 2)
+                keyed = _mm_cmpeq_epi16(v, k);
+            else
+                keyed = _mm_cmpeq_epi32(v, k);
+
+            // Sprites are mostly solid runs and empty runs; skip the blend for both
+            const int mask = _mm_movemask_epi8(keyed);
+            if (mask == 0xFFFF)
+                continue;
+
+            __m128i* out = reinterpret_cast<__m128i*>(dst + i);
+            if (mask == 0)
+                _mm_storeu_si128(out, v);
+            else
+                _mm_storeu_si128(out, _mm_or_si128(_mm_and_si128(keyed, _mm_loadu_si128(out)), _mm_andnot_si128(keyed, v)));
+        }
+
+        KeyScalar<T>(reinterpret_cast<uint8_t*>(dst + i), reinterpret_cast<const uint8_t*>(src + i), count - i, key);
+    }
+
+    template <typename T>
+    OPUS_TARGET_AVX2 void KeyAVX2(uint8_t* dstBytes, const uint8_t* srcBytes, size_t count, uint32_t key)
+    {
+        constexpr size_t lanes = 32 / sizeof(T);
+        T* dst = reinterpret_cast<T*>(dstBytes);
+        const T* src = reinterpret_cast<const T*>(srcBytes);
+
+        __m256i k;
+        if constexpr (sizeof(T) == 1)
+            k = _mm256_set1_epi8(char(key));
+        else if constexpr (sizeof(T) == 2)
+            k = _mm256_set1_epi16(int16_t(key));
+        else
+            k = _mm256_set1_epi32(int32_t(key));
+
+        size_t i = 0;
+        for (; i + lanes <= count; i += lanes)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i keyed;
+            if constexpr (sizeof(T) == 1)
+                keyed = _mm256_cmpeq_epi8(v, k);
+            else if constexpr (sizeof(T) == 2)
+                keyed = _mm256_cmpeq_epi16(v, k);
+            else
+                keyed = _mm256_cmpeq_epi32(v, k);
+
+            const int mask = _mm256_movemask_epi8(keyed);
+            if (mask == -1)
+                continue;
+
+            __m256i* out = reinterpret_cast<__m256i*>(dst + i);
+            if (mask == 0)
+                _mm256_storeu_si256(out, v);
+            else
+                _mm256_storeu_si256(out, _mm256_blendv_epi8(v, _mm256_loadu_si256(out), keyed));
+        }
+
+        KeyScalar<T>(reinterpret_cast<uint8_t*>(dst + i), reinterpret_cast<const uint8_t*>(src + i), count - i, key);
+    }
+
+    // BlendChannel on 16-bit lanes holding two unpacked pixels
+    OPUS_TARGET_SSE2 inline __m128i BlendLanesSSE2(__m128i s, __m128i d)
+    {
+        const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), a);
+        const __m128i v = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, inverse)),
+                                        _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+    }
+
+    OPUS_TARGET_SSE2 void BlendSSE2(uint32_t* dst, const uint32_t* src, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alphaMask = _mm_set1_epi32(int32_t(0xFF000000u));
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const __m128i alpha = _mm_and_si128(s, alphaMask);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF)
+                continue;
+
+            __m128i* out = reinterpret_cast<__m128i*>(dst + i);
+            const __m128i d = _mm_loadu_si128(out);
+
+            __m128i rgb = s;
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) != 0xFFFF)
+            {
+                const __m128i lo = BlendLanesSSE2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+                const __m128i hi = BlendLanesSSE2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+                rgb = _mm_packus_epi16(lo, hi);
+            }
+            _mm_storeu_si128(out, _mm_or_si128(_mm_andnot_si128(alphaMask, rgb), _mm_and_si128(d, alphaMask)));
+        }
+
+        BlendScalar(dst + i, src + i, count - i);
+    }
+
+    OPUS_TARGET_AVX2 inline __m256i BlendLanesAVX2(__m256i s, __m256i d)
+    {
+        const __m256i a =
+            _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        const __m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+        const __m256i v = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, inverse)), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)), 8);
+    }
+
+    OPUS_TARGET_AVX2 void BlendAVX2(uint32_t* dst, const uint32_t* src, size_t count)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i alphaMask = _mm256_set1_epi32(int32_t(0xFF000000u));
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            const __m256i alpha = _mm256_and_si256(s, alphaMask);
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, zero)) == -1)
+                continue;
+
+            __m256i* out = reinterpret_cast<__m256i*>(dst + i);
+            const __m256i d = _mm256_loadu_si256(out);
+
+            // Unpack and pack both work within 128-bit lanes, so pixels stay in order
+            __m256i rgb = s;
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) != -1)
+            {
+                const __m256i lo = BlendLanesAVX2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+                const __m256i hi = BlendLanesAVX2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+                rgb = _mm256_packus_epi16(lo, hi);
+            }
+            _mm256_storeu_si256(out, _mm256_or_si256(_mm256_andnot_si256(alphaMask, rgb), _mm256_and_si256(d, alphaMask)));
+        }
+
+        // GCC drops the implicit vzeroupper on this tail call, and dirty upper
+        // halves make the SSE code around every alpha blit several times slower
+        _mm256_zeroupper();
+        BlendScalar(dst + i, src + i, count - i);
+    }
+#endif
+
+    bool CpuHas(Isa isa)
+    {
+        if (isa == Isa::Scalar)
+            return true;
+
+#if OPUS_KERNELS_X86 && defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        const int maxLeaf = regs[0];
+
+        __cpuid(regs, 1);
+        if (isa == Isa::SSE2)
+            return (regs[3] & (1 << 26)) != 0;
+
+        // AVX2 also needs the OS to save YMM state
+        const bool osxsave = (regs[2] & (1 << 27)) != 0;
+        if (!osxsave || maxLeaf < 7 || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#elif OPUS_KERNELS_X86
+        __builtin_cpu_init();
+        if (isa == Isa::SSE2)
+            return __builtin_cpu_supports("sse2");
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+    struct Dispatch
+    {
+        Isa isa = Isa::Scalar;
+        FillFn fill = FillScalar;
+        Expand16Fn expand16 = Expand16Scalar;
+        Expand32Fn expand32 = Expand32Scalar;
+        ReverseFn reverse[3] = {ReverseScalar<uint8_t>, ReverseScalar<uint16_t>, ReverseScalar<uint32_t>}; // By bpp / 2
+        KeyFn key[3] = {KeyScalar<uint8_t>, KeyScalar<uint16_t>, KeyScalar<uint32_t>};
+        BlendFn blend = BlendScalar;
+    };
+
+    // SSE2 has no gather, and 256-entry tables are far too large for byte
+    // shuffles, so palette expansion stays scalar below AVX2.
+    Dispatch DispatchFor(Isa isa)
+    {
+        Dispatch dispatch;
+        dispatch.isa = isa;
+#if OPUS_KERNELS_X86
+        if (isa == Isa::AVX2)
+        {
+            dispatch.fill = FillAVX2;
+            dispatch.expand16 = Expand16AVX2;
+            dispatch.expand32 = Expand32AVX2;
+            dispatch.key[0] = KeyAVX2<uint8_t>;
+            dispatch.key[1] = KeyAVX2<uint16_t>;
+            dispatch.key[2] = KeyAVX2<uint32_t>;
+            dispatch.blend = BlendAVX2;
+        }
+        else if (isa == Isa::SSE2)
+        {
+            dispatch.fill = FillSSE2;
+            dispatch.key[0] = KeySSE2<uint8_t>;
+            dispatch.key[1] = KeySSE2<uint16_t>;
+            dispatch.key[2] = KeySSE2<uint32_t>;
+            dispatch.blend = BlendSSE2;
+        }
+
+        if (isa != Isa::Scalar)
+        {
+            dispatch.reverse[0] = ReverseSSE2<uint8_t>;
+            dispatch.reverse[1] = ReverseSSE2<uint16_t>;
+            dispatch.reverse[2] = ReverseSSE2<uint32_t>;
+        }
+#endif
+        return dispatch;
+    }
+
+    Dispatch& GetDispatch()
+    {
+        static Dispatch dispatch = []
+        {
+            for (Isa isa : {Isa::AVX2, Isa::SSE2})
+            {
+                if (CpuHas(isa))
+                    return DispatchFor(isa);
+            }
+            return Dispatch{};
+        }();
+        return dispatch;
+    }
+
+    uint32_t PatternOf(uint32_t packed, uint32_t bpp)
+    {
+        if (bpp == 1)
+            return (packed & 0xFFu) * 0x01010101u;
+        return bpp == 2 ? (packed & 0xFFFFu) * 0x10001u : packed;
+    }
+
+    // Flipped and 16-bit alpha rows go through stack scratch this many pixels at a time
+    constexpr size_t BLIT_CHUNK = 256;
+
+    // 16-bit targets are widened, blended and narrowed back. Narrowing a
+    // widened pixel gives the original, so untouched pixels keep their value.
+    template <typename Format>
+    void BlendNarrow(const Dispatch& dispatch, uint8_t* dstBytes, const uint32_t* src, size_t count)
+    {
+        using opus::gfx::pixel::XRGB8888;
+
+        uint16_t* dst = reinterpret_cast<uint16_t*>(dstBytes);
+        alignas(32) uint32_t wide[BLIT_CHUNK];
+        opus::gfx::pixel::Convert<Format, XRGB8888>(dst, wide, count);
+        dispatch.blend(wide, src, count);
+        opus::gfx::pixel::Convert<XRGB8888, Format>(wide, dst, count);
+    }
+
+    void BlitRow(const Dispatch& dispatch, uint8_t* dst, const uint8_t* src, size_t count,
+                 opus::gfx::PixelFormat dstFormat, uint32_t srcBpp, const opus::gfx::BlitOptions& options)
+    {
+        using opus::gfx::BlendMode;
+        using opus::gfx::PixelFormat;
+
+        if (options.mode == BlendMode::Opaque)
+        {
+            if (options.flipX)
+                dispatch.reverse[srcBpp / 2](dst, src, count);
+            else
+                std::memcpy(dst, src, count * srcBpp);
+            return;
+        }
+
+        const uint32_t dstBpp = opus::gfx::BytesPerPixel(dstFormat);
+        alignas(32) uint8_t reversed[BLIT_CHUNK * 4];
+
+        for (size_t done = 0; done < count; done += BLIT_CHUNK)
+        {
+            const size_t n = std::min(BLIT_CHUNK, count - done);
+
+            // Chunk k of a flipped row is the mirror of chunk k from the far end
+            const uint8_t* chunk = src + done * srcBpp;
+            if (options.flipX)
+            {
+                dispatch.reverse[srcBpp / 2](reversed, src + (count - done - n) * srcBpp, n);
+                chunk = reversed;
+            }
+
+            uint8_t* out = dst + done * dstBpp;
+            if (options.mode == BlendMode::ColorKey)
+                dispatch.key[srcBpp / 2](out, chunk, n, options.key);
+            else if (dstFormat == PixelFormat::XRGB8888)
+                dispatch.blend(reinterpret_cast<uint32_t*>(out), reinterpret_cast<const uint32_t*>(chunk), n);
+            else if (dstFormat == PixelFormat::RGB565)
+                BlendNarrow<opus::gfx::pixel::RGB565>(dispatch, out, reinterpret_cast<const uint32_t*>(chunk), n);
+            else
+                BlendNarrow<opus::gfx::pixel::XRGB1555>(dispatch, out, reinterpret_cast<const uint32_t*>(chunk), n);
+        }
+    }
+}
+
+namespace opus::gfx::kernels
+{
+    // Dispatch
+    Isa GetIsa() { return GetDispatch().isa; }
+
+    bool SetIsa(Isa isa)
+    {
+        if (!CpuHas(isa))
+            return false;
+
+        GetDispatch() = DispatchFor(isa);
+        return true;
+    }
+
+    bool IsSupported(Isa isa) { return CpuHas(isa); }
+
+    const char* IsaName(Isa isa)
+    {
+        switch (isa)
+        {
+        case Isa::SSE2: return "SSE2";
+        case Isa::AVX2: return "AVX2";
+        default: return "Scalar";
+        }
+    }
+
+    // Row Primitives
+    void FillRow(uint8_t* dst, uint32_t count, uint32_t packed, PixelFormat format)
+    {
+        const uint32_t bpp = BytesPerPixel(format);
+        GetDispatch().fill(dst, size_t(count) * bpp, PatternOf(packed, bpp));
+    }
+
+    // Surface Operations
+    void FillRect(const Surface& target, const Rect& rect, uint32_t packed)
+    {
+        const Rect r = rect.Intersect(target.GetClip());
+        if (r.IsEmpty())
+            return;
+
+        const uint32_t bpp = BytesPerPixel(target.GetFormat());
+        const uint32_t pattern = PatternOf(packed, bpp);
+        const size_t offset = size_t(r.x) * bpp;
+        const size_t bytes = size_t(r.w) * bpp;
+
+        const FillFn fill = GetDispatch().fill;
+        for (int32_t y = r.y; y < r.Bottom(); ++y)
+            fill(target.GetRow(uint32_t(y)) + offset, bytes, pattern);
+    }
+
+    void DrawLine(const Surface& target, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t packed)
+    {
+        // Straight lines are one-pixel rects
+        if (x0 == x1 || y0 == y1)
+        {
+            FillRect(target, Rect{std::min(x0, x1), std::min(y0, y1), std::abs(x1 - x0) + 1, std::abs(y1 - y0) + 1},
+                     packed);
+            return;
+        }
+
+        const Rect clip = target.GetClip();
+        const uint32_t bpp = BytesPerPixel(target.GetFormat());
+
+        // Bresenham; pixels outside the clip are stepped over, not drawn
+        const int32_t dx = std::abs(x1 - x0);
+        const int32_t dy = -std::abs(y1 - y0);
+        const int32_t sx = x0 < x1 ? 1 : -1;
+        const int32_t sy = y0 < y1 ? 1 : -1;
+        int32_t error = dx + dy;
+        for (;;)
+        {
+            if (x0 >= clip.x && x0 < clip.Right() && y0 >= clip.y && y0 < clip.Bottom())
+            {
+                uint8_t* pixel = target.GetRow(uint32_t(y0)) + size_t(x0) * bpp;
+                if (bpp == 4)
+                    *reinterpret_cast<uint32_t*>(pixel) = packed;
+                else if (bpp == 2)
+                    *reinterpret_cast<uint16_t*>(pixel) = uint16_t(packed);
+                else
+                    *pixel = uint8_t(packed);
+            }
+
+            if (x0 == x1 && y0 == y1)
+                break;
+
+            const int32_t twice = 2 * error;
+            if (twice >= dy)
+            {
+                error += dy;
+                x0 += sx;
+            }
+            if (twice <= dx)
+            {
+                error += dx;
+                y0 += sy;
+            }
+        }
+    }
+
+    void FillPattern(const Surface& target, const Rect& rect, uint32_t packedA, uint32_t packedB,
+                     uint32_t tileW, uint32_t tileH)
+    {
+        const Rect r = rect.Intersect(target.GetClip());
+        if (r.IsEmpty())
+            return;
+
+        tileW = std::max(tileW, 1u);
+        tileH = std::max(tileH, 1u);
+
+        const uint32_t bpp = BytesPerPixel(target.GetFormat());
+        const uint32_t patterns[2] = {PatternOf(packedA, bpp), PatternOf(packedB, bpp)};
+        const size_t offset = size_t(r.x) * bpp;
+        const size_t bytes = size_t(r.w) * bpp;
+        const FillFn fill = GetDispatch().fill;
+
+        // Every row of a tile band is the same, and bands alternate between
+        // two layouts. Each layout is built once from runs, then copied.
+        const uint8_t* layouts[2] = {nullptr, nullptr};
+
+        uint32_t y = uint32_t(r.y);
+        const uint32_t bottom = uint32_t(r.Bottom());
+        while (y < bottom)
+        {
+            const uint32_t ty = y / tileH;
+            const uint32_t bandEnd = std::min(bottom, (ty + 1) * tileH);
+            uint8_t* row = target.GetRow(y) + offset;
+
+            const uint8_t*& layout = layouts[ty & 1];
+            if (layout)
+            {
+                std::memcpy(row, layout, bytes);
+            }
+            else
+            {
+                uint32_t x = uint32_t(r.x);
+                const uint32_t right = uint32_t(r.Right());
+                while (x < right)
+                {
+                    const uint32_t tx = x / tileW;
+                    const uint32_t runEnd = std::min(right, (tx + 1) * tileW);
+                    fill(target.GetRow(y) + size_t(x) * bpp, size_t(runEnd - x) * bpp, patterns[(tx + ty) & 1]);
+                    x = runEnd;
+                }
+                layout = row;
+            }
+
+            for (uint32_t band = y + 1; band < bandEnd; ++band)
+                std::memcpy(target.GetRow(band) + offset, row, bytes);
+
+            y = bandEnd;
+        }
+    }
+
+    void ReplicateRow(const Surface& target, int32_t srcY, const Rect& rect)
+    {
+        const Rect r = rect.Intersect(target.GetClip());
+        if (r.IsEmpty() || srcY < 0 || srcY >= int32_t(target.GetHeight()))
+            return;
+
+        // memcpy is already the widest copy the platform has
+        const uint32_t bpp = BytesPerPixel(target.GetFormat());
+        const size_t offset = size_t(r.x) * bpp;
+        const size_t bytes = size_t(r.w) * bpp;
+        const uint8_t* src = target.GetRow(uint32_t(srcY)) + offset;
+
+        for (int32_t y = r.y; y < r.Bottom(); ++y)
+        {
+            if (y != srcY)
+                std::memcpy(target.GetRow(uint32_t(y)) + offset, src, bytes);
+        }
+    }
+
+    // Palette Expansion
+    bool Expand(const Surface& src, const Surface& dst, const Palette& palette)
+    {
+        if (src.GetFormat() != PixelFormat::Indexed8 ||
+            (dst.GetFormat() != PixelFormat::RGB565 && dst.GetFormat() != PixelFormat::XRGB8888))
+            return false;
+
+        const Rect r = dst.GetClip().Intersect(src.GetBounds());
+        if (r.IsEmpty())
+            return true;
+
+        // The palette keeps both tables current; nothing is converted here
+        const Dispatch& dispatch = GetDispatch();
+        if (dst.GetFormat() == PixelFormat::RGB565)
+        {
+            const uint16_t* lut = palette.GetRGB565Table();
+            for (int32_t y = r.y; y < r.Bottom(); ++y)
+                dispatch.expand16(dst.GetRowAs<uint16_t>(uint32_t(y)) + r.x, src.GetRow(uint32_t(y)) + r.x, size_t(r.w), lut);
+        }
+        else
+        {
+            const uint32_t* lut = palette.GetXRGB8888Table();
+            for (int32_t y = r.y; y < r.Bottom(); ++y)
+                dispatch.expand32(dst.GetRowAs<uint32_t>(uint32_t(y)) + r.x, src.GetRow(uint32_t(y)) + r.x, size_t(r.w), lut);
+        }
+        return true;
+    }
+
+    // Format Conversion
+    bool Convert(const Surface& src, const Surface& dst)
+    {
+        if (src.GetFormat() == PixelFormat::Indexed8 || dst.GetFormat() == PixelFormat::Indexed8)
+            return false;
+
+        const Rect r = dst.GetClip().Intersect(src.GetBounds());
+        if (r.IsEmpty())
+            return true;
+
+        // One specialized row loop per (source, destination) pair
+        return pixel::Visit(src.GetFormat(), [&](auto srcFormat)
+        {
+            pixel::Visit(dst.GetFormat(), [&](auto dstFormat)
+            {
+                using Src = decltype(srcFormat);
+                using Dst = decltype(dstFormat);
+                using SrcPixel = typename Src::Storage;
+                using DstPixel = typename Dst::Storage;
+
+                for (int32_t y = r.y; y < r.Bottom(); ++y)
+                {
+                    pixel::Convert<Src, Dst>(src.GetRowAs<const SrcPixel>(uint32_t(y)) + r.x,
+                                             dst.GetRowAs<DstPixel>(uint32_t(y)) + r.x, size_t(r.w));
+                }
+            });
+        });
+    }
+
+    // Sprite Blits
+    bool Blit(const Surface& target, int32_t x, int32_t y, const Surface& src, const Rect& srcRect,
+              const BlitOptions& options)
+    {
+        const PixelFormat dstFormat = target.GetFormat();
+        const PixelFormat srcFormat = src.GetFormat();
+        if (options.mode == BlendMode::Alpha)
+        {
+            if (srcFormat != PixelFormat::XRGB8888 || dstFormat == PixelFormat::Indexed8)
+                return false;
+        }
+        else if (srcFormat != dstFormat)
+        {
+            return false;
+        }
+
+        const Rect frame = srcRect.Intersect(src.GetBounds());
+        const Rect placed{x, y, frame.w, frame.h};
+        const Rect r = placed.Intersect(target.GetClip());
+        if (r.IsEmpty())
+            return true;
+
+        // Frame column feeding the first destination pixel, or the last one
+        // when flipped (the row is then read backwards from the far end)
+        const int32_t column = options.flipX ? placed.Right() - r.Right() : r.x - x;
+        const uint32_t srcBpp = BytesPerPixel(srcFormat);
+        const size_t srcOffset = size_t(frame.x + column) * srcBpp;
+        const size_t dstOffset = size_t(r.x) * BytesPerPixel(dstFormat);
+
+        const Dispatch& dispatch = GetDispatch();
+        for (int32_t dy = r.y; dy < r.Bottom(); ++dy)
+        {
+            const int32_t row = options.flipY ? placed.Bottom() - 1 - dy : dy - y;
+            BlitRow(dispatch, target.GetRow(uint32_t(dy)) + dstOffset, src.GetRow(uint32_t(frame.y + row)) + srcOffset,
+                    size_t(r.w), dstFormat, srcBpp, options);
+        }
+        return true;
+    }
+}
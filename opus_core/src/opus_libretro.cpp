@@ -18,37 +18,123 @@ static retro_input_state_t        g_input_state = nullptr;
 static constexpr int WIDTH  = 320;
 static constexpr int HEIGHT = 240;
 
-static uint16_t g_framebuffer[WIDTH * HEIGHT];
+// Rows are 64-byte aligned; pass GetPitch() to the frontend, not WIDTH * 2
+static opus::gfx::Surface g_framebuffer(WIDTH, HEIGHT, opus::gfx::PixelFormat::RGB565);
+
+// View of the frontend's own framebuffer; only valid until the next g_video
+static opus::gfx::Surface g_frontend_framebuffer;
+
+// The scene draws palette indices (half the bytes of RGB565); presenting
+// expands them once into whichever buffer goes to the frontend.
+static opus::gfx::Surface g_indexed(WIDTH, HEIGHT, opus::gfx::PixelFormat::Indexed8);
+static opus::gfx::Palette g_palette;
+
+static bool     g_can_dupe                = false; // Frontend accepts g_video(NULL) for "same as last frame"
+static bool     g_has_presented           = false;
+static uint64_t g_presented_generation    = 0;       // g_indexed generation last sent to the frontend
+static uint64_t g_presented_palette       = 0;       // g_palette version last sent to the frontend
+static uint64_t g_framebuffer_generation  = ~0ull;   // g_indexed generation expanded into g_framebuffer
+static uint64_t g_framebuffer_palette     = ~0ull;   // g_palette version expanded into g_framebuffer
 
 // Checkerboard config (tile size in pixels)
 static constexpr int TILE_W = 8;
 static constexpr int TILE_H = 8;
 
-// RGB565 colors
-static constexpr uint16_t RGB565_RED  = 0xF800;
-static constexpr uint16_t RGB565_BLUE = 0x001F;
+// Palette indices
+static constexpr uint8_t INDEX_RED  = 1;
+static constexpr uint8_t INDEX_BLUE = 2;
+
+// ------------------------------------------------------------
+// Scheduling
+// ------------------------------------------------------------
+// Share of the frame period deferrable tasks may fill; the rest is
+// headroom for the frontend.
+static constexpr double DEFERRED_BUDGET_SHARE = 0.75;
 
-static void render_checkerboard_rgb565()
+// Workers for Parallel children and banded redraws. Sized to the machine;
+// with one hardware thread it has no workers and everything runs inline.
+static std::unique_ptr<opus::jobs::JobPool> g_pool;
+
+static opus::tasks::TaskContainer         g_tasks;      // Mandatory, every frame
+static opus::tasks::DeferredTaskContainer g_deferred;   // Runs in the time left over
+static uint64_t                           g_frame_count = 0;
+static uint64_t                           g_frame_budget_ns = 0;
+
+// Asks the frontend for memory to draw into so g_video needs no copy. Falls
+// back to the internal buffer when it declines or offers another format.
+static const opus::gfx::Surface& acquire_render_target()
 {
-   for (int y = 0; y < HEIGHT; ++y)
+   retro_framebuffer fb;
+   std::memset(&fb, 0, sizeof(fb));
+   fb.width        = WIDTH;
+   fb.height       = HEIGHT;
+   fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+   if (g_environ && g_environ(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb) &&
+       fb.data && fb.format == RETRO_PIXEL_FORMAT_RGB565 &&
+       fb.width >= WIDTH && fb.height >= HEIGHT && fb.pitch >= WIDTH * sizeof(uint16_t))
    {
-      const int ty = (y / TILE_H);
-      for (int x = 0; x < WIDTH; ++x)
-      {
-         const int tx = (x / TILE_W);
-         const bool even = ((tx + ty) & 1) == 0;
-         g_framebuffer[y * WIDTH + x] = even ? RGB565_RED : RGB565_BLUE;
-      }
+      // Frontends usually hand out the same memory every frame; wrapping it
+      // again would allocate a new view each time
+      if (fb.data != g_frontend_framebuffer.GetData() || fb.pitch != g_frontend_framebuffer.GetPitch())
+         g_frontend_framebuffer = opus::gfx::Surface::Wrap(fb.data, WIDTH, HEIGHT, fb.pitch,
+                                                           opus::gfx::PixelFormat::RGB565);
+      return g_frontend_framebuffer;
    }
+
+   return g_framebuffer;
 }
 
+static void render_checkerboard(const opus::gfx::Surface& target)
+{
+   // Only the clip rect: partial redraws repaint just the dirty regions
+   opus::gfx::kernels::FillPattern(target, target.GetClip(), INDEX_RED, INDEX_BLUE, TILE_W, TILE_H);
+}
+
+// ------------------------------------------------------------
+// Scene
+// ------------------------------------------------------------
+class Checkerboard : public opus::gfx::Drawable
+{
+public:
+   void Draw(opus::gfx::Surface& target) override { render_checkerboard(target); }
+};
+
+static Checkerboard             g_checkerboard;
+static opus::gfx::DrawableTask  g_scene; // Redraws only when something visible changed
+
 // ------------------------------------------------------------
 // libretro API (export EVERYTHING RetroArch expects)
 // ------------------------------------------------------------
 extern "C" {
 
-RETRO_API void retro_init(void) {}
-RETRO_API void retro_deinit(void) {}
+RETRO_API void retro_init(void)
+{
+   retro_system_av_info av;
+   retro_get_system_av_info(&av);
+   g_frame_budget_ns = static_cast<uint64_t>(1e9 / av.timing.fps);
+   g_frame_count = 0;
+
+   g_palette.SetColor(INDEX_RED, opus::gfx::Color::FromRGB(255, 0, 0));
+   g_palette.SetColor(INDEX_BLUE, opus::gfx::Color::FromRGB(0, 0, 255));
+
+   g_pool = std::make_unique<opus::jobs::JobPool>(opus::jobs::JobPool::DefaultWorkerCount());
+   g_tasks.SetJobPool(g_pool.get());
+   g_tasks.SetExecutionMode(opus::tasks::ExecutionMode::Parallel);
+
+   g_scene.SetName("Scene");
+   g_scene.SetTarget(g_indexed);
+   g_scene.SetJobPool(g_pool.get());
+   g_scene.AddDrawable(g_checkerboard);
+   g_scene.Enable();
+}
+RETRO_API void retro_deinit(void)
+{
+   // Nothing may hand work to the pool once its workers are joined
+   g_scene.SetJobPool(nullptr);
+   g_tasks.SetJobPool(nullptr);
+   g_pool.reset();
+}
 
 RETRO_API unsigned retro_api_version(void) { return RETRO_API_VERSION; }
 
@@ -105,7 +191,12 @@ RETRO_API void retro_reset(void) {}
 
 RETRO_API bool retro_load_game(const retro_game_info* /*game*/)
 {
-   std::memset(g_framebuffer, 0, sizeof(g_framebuffer));
+   g_indexed.Fill(opus::gfx::Color(0));
+
+   g_can_dupe = false;
+   if (g_environ)
+      g_environ(RETRO_ENVIRONMENT_GET_CAN_DUPE, &g_can_dupe);
+   g_has_presented = false;
    return true;
 }
 
@@ -133,16 +224,60 @@ RETRO_API size_t retro_get_memory_size(unsigned /*id*/) { return 0; }
 
 RETRO_API void retro_run(void)
 {
+   const uint64_t frame_start = opus::profiler::NowNs();
+
+   // Scratch from the last frame is dead; its storage is reused, and the
+   // workers' arenas are reset before they next take a job
+   opus::memory::GetFrameArena().Reset();
+   g_pool->NextFrame();
+
    if (g_input_poll)
       g_input_poll();
 
-   render_checkerboard_rgb565();
+   g_tasks.Update(g_frame_count);
 
-   const size_t pitch = WIDTH * sizeof(uint16_t);
-   if (g_video)
-      g_video(g_framebuffer, WIDTH, HEIGHT, pitch);
+   // Redraws only the dirty regions of the indexed scene
+   g_scene.Update(g_frame_count);
+
+   // Palette animation changes the output without touching g_indexed
+   const uint64_t generation = g_indexed.GetGeneration();
+   const uint64_t palette    = g_palette.GetVersion();
+   if (g_can_dupe && g_has_presented && generation == g_presented_generation && palette == g_presented_palette)
+   {
+      // Nothing visible changed: no expansion, no upload
+      if (g_video)
+         g_video(nullptr, WIDTH, HEIGHT, 0);
+   }
+   else
+   {
+      const opus::gfx::Surface& target = acquire_render_target();
+
+      // Present stage. The frontend's buffer is not guaranteed to still hold
+      // our last frame; the internal one may already be current.
+      if (&target != &g_framebuffer || g_framebuffer_generation != generation || g_framebuffer_palette != palette)
+      {
+         opus::gfx::kernels::Expand(g_indexed, target, g_palette);
+         if (&target == &g_framebuffer)
+         {
+            g_framebuffer_generation = generation;
+            g_framebuffer_palette    = palette;
+         }
+      }
+
+      if (g_video)
+         g_video(target.GetData(), WIDTH, HEIGHT, target.GetPitch());
+      g_presented_generation = generation;
+      g_presented_palette    = palette;
+      g_has_presented = true;
+   }
 
    // No audio for this test core.
+
+   // Deferrable work fills what is left of the frame budget
+   g_deferred.SetDeadline(frame_start + static_cast<uint64_t>(g_frame_budget_ns * DEFERRED_BUDGET_SHARE));
+   g_deferred.Update(g_frame_count);
+
+   ++g_frame_count;
 }
 
 } // extern "C"
@@ -0,0 +1,143 @@
+#include "opus_memory.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    // Relaxed: these are statistics, read between frames
+    std::atomic<uint64_t> g_allocations{0};
+    std::atomic<uint64_t> g_frees{0};
+    std::atomic<uint64_t> g_bytes{0};
+}
+
+// Heap Traffic
+namespace opus::memory
+{
+    Stats GetStats()
+    {
+        Stats stats;
+        stats.allocations = g_allocations.load(std::memory_order_relaxed);
+        stats.frees = g_frees.load(std::memory_order_relaxed);
+        stats.bytes = g_bytes.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void* AllocateBlock(size_t size, size_t alignment)
+    {
+        void* block = ::operator new(size, std::align_val_t(alignment));
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytes.fetch_add(size, std::memory_order_relaxed);
+        return block;
+    }
+
+    void FreeBlock(void* block, size_t size, size_t alignment)
+    {
+        if (!block)
+            return;
+
+        ::operator delete(block, std::align_val_t(alignment));
+        g_frees.fetch_add(1, std::memory_order_relaxed);
+        g_bytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+}
+
+// Class FrameArena
+namespace opus::memory
+{
+    // Constructor and Destructor
+    FrameArena::FrameArena(size_t chunkSize) : m_chunkSize(std::max<size_t>(chunkSize, CHUNK_ALIGNMENT)) {}
+
+    FrameArena::~FrameArena()
+    {
+        for (const Chunk& chunk : m_chunks)
+            FreeBlock(chunk.data, chunk.size, CHUNK_ALIGNMENT);
+    }
+
+    // Allocation
+    void* FrameArena::Allocate(size_t size, size_t alignment)
+    {
+        for (;;)
+        {
+            if (m_chunk < m_chunks.size())
+            {
+                const Chunk& chunk = m_chunks[m_chunk];
+                const uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data);
+                const size_t begin = ((base + m_offset + alignment - 1) & ~uintptr_t(alignment - 1)) - base;
+                if (begin <= chunk.size && size <= chunk.size - begin)
+                {
+                    m_used += begin + size - m_offset;
+                    m_offset = begin + size;
+                    m_peak = std::max(m_peak, m_used);
+                    return chunk.data + begin;
+                }
+
+                // Too small: skip the tail and carve the next chunk
+                m_used += chunk.size - m_offset;
+                m_offset = 0;
+                if (++m_chunk < m_chunks.size())
+                    continue;
+            }
+
+            const size_t chunkSize = std::max(m_chunkSize, size + alignment);
+            m_chunks.push_back(Chunk{static_cast<std::byte*>(AllocateBlock(chunkSize, CHUNK_ALIGNMENT)), chunkSize});
+            m_chunk = m_chunks.size() - 1;
+            m_offset = 0;
+        }
+    }
+
+    // Control
+    FrameArena::Mark FrameArena::GetMark() const
+    {
+        return Mark{m_chunk, m_offset, m_used, m_resets};
+    }
+
+    void FrameArena::Rewind(const Mark& mark)
+    {
+        if (mark.reset != m_resets || mark.used >= m_used)
+            return;
+
+        m_chunk = mark.chunk;
+        m_offset = mark.offset;
+        m_used = mark.used;
+    }
+
+    void FrameArena::Reset()
+    {
+        // One chunk that holds what the chunks did, so the next frame like
+        // this one carves it without allocating
+        if (m_chunks.size() > 1)
+        {
+            const size_t capacity = GetCapacity();
+            for (const Chunk& chunk : m_chunks)
+                FreeBlock(chunk.data, chunk.size, CHUNK_ALIGNMENT);
+            m_chunks.clear();
+            m_chunks.push_back(Chunk{static_cast<std::byte*>(AllocateBlock(capacity, CHUNK_ALIGNMENT)), capacity});
+        }
+
+        m_chunk = 0;
+        m_offset = 0;
+        m_used = 0;
+        ++m_resets;
+    }
+
+    // Getters
+    size_t FrameArena::GetUsed() const { return m_used; }
+
+    size_t FrameArena::GetCapacity() const
+    {
+        size_t capacity = 0;
+        for (const Chunk& chunk : m_chunks)
+            capacity += chunk.size;
+        return capacity;
+    }
+
+    size_t FrameArena::GetPeak() const { return m_peak; }
+
+    FrameArena& GetFrameArena()
+    {
+        // Per thread: containers updated on workers build their graphs too
+        thread_local FrameArena arena;
+        return arena;
+    }
+}
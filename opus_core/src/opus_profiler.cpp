@@ -0,0 +1,165 @@
+#include "opus_profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Relaxed atomics, so the exporter may read a slot while it is rewritten
+    struct Slot
+    {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> begin{0};
+        std::atomic<uint64_t> end{0};
+    };
+
+    // Written only by its owning thread; readers use the published head and
+    // drop whatever the owner may have overwritten while they copied
+    struct ThreadBuffer
+    {
+        static constexpr uint64_t CAPACITY = 1u << 15; // Power of two
+        std::array<Slot, CAPACITY> events;
+        std::atomic<uint64_t> head{0};
+        uint64_t start = 0; // Events before this were dropped by Reset() (registry mutex)
+        uint32_t threadId = 0;
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers; // Outlive their threads
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    thread_local ThreadBuffer* t_buffer = nullptr;
+
+    ThreadBuffer& GetThreadBuffer()
+    {
+        if (!t_buffer)
+        {
+            // Once per thread
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+            t_buffer = registry.buffers.back().get();
+            t_buffer->threadId = uint32_t(registry.buffers.size());
+        }
+        return *t_buffer;
+    }
+
+    void AppendEscaped(std::string& out, const char* text)
+    {
+        for (const char* c = text ? text : "?"; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                out += '\\';
+            if (static_cast<unsigned char>(*c) >= 0x20)
+                out += *c;
+        }
+    }
+}
+
+namespace opus::profiler
+{
+    // Timestamps
+    uint64_t NowNs()
+    {
+        using namespace std::chrono;
+        return uint64_t(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Recording
+    void Record(const char* name, uint64_t begin, uint64_t end)
+    {
+        ThreadBuffer& buffer = GetThreadBuffer();
+        const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+
+        // An exporter that reads any of this write then sees at least this head
+        std::atomic_thread_fence(std::memory_order_release);
+        Slot& slot = buffer.events[head & (ThreadBuffer::CAPACITY - 1)];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.begin.store(begin, std::memory_order_relaxed);
+        slot.end.store(end, std::memory_order_relaxed);
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    // Export
+    std::string ChromeTrace()
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        std::string out;
+        out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool first = true;
+        char number[96];
+        std::vector<Event> events;
+        for (const auto& buffer : registry.buffers)
+        {
+            // Copy while the owner keeps recording, then keep only the slots it
+            // cannot have reached since: index head, still being written, reuses
+            // the slot of head - CAPACITY
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            const uint64_t tail = std::max(buffer->start, head > ThreadBuffer::CAPACITY ? head - ThreadBuffer::CAPACITY : 0);
+            events.clear();
+            for (uint64_t i = tail; i < head; ++i)
+            {
+                const Slot& slot = buffer->events[i & (ThreadBuffer::CAPACITY - 1)];
+                events.push_back(Event{slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed),
+                                       slot.end.load(std::memory_order_relaxed)});
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t now = buffer->head.load(std::memory_order_relaxed);
+            const uint64_t valid = now >= ThreadBuffer::CAPACITY ? now - ThreadBuffer::CAPACITY + 1 : 0;
+            const size_t skip = size_t(std::min(head - tail, valid > tail ? valid - tail : 0));
+
+            for (size_t k = skip; k < events.size(); ++k)
+            {
+                const Event& e = events[k];
+                out += first ? "{\"name\":\"" : ",{\"name\":\"";
+                AppendEscaped(out, e.name);
+                std::snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                              buffer->threadId, double(e.begin) / 1000.0, double(e.end - e.begin) / 1000.0);
+                out += number;
+                first = false;
+            }
+        }
+
+        out += "]}";
+        return out;
+    }
+
+    bool WriteChromeTrace(const char* path)
+    {
+        const std::string json = ChromeTrace();
+
+        std::FILE* file = std::fopen(path, "wb");
+        if (!file)
+            return false;
+
+        const bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+        return (std::fclose(file) == 0) && ok;
+    }
+
+    void Reset()
+    {
+        // Heads belong to their threads; export just starts from here
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& buffer : registry.buffers)
+            buffer->start = buffer->head.load(std::memory_order_acquire);
+    }
+}
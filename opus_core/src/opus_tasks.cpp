@@ -1,5 +1,18 @@
 #include "opus_tasks.h"
 
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <typeinfo>
+#include <utility>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+#include "opus_memory.h"
+#include "opus_profiler.h"
+
 // Class Task
 namespace opus::tasks
 {
@@ -15,7 +28,20 @@ namespace opus::tasks
         m_offset = (m_modulo > 0) ? (offset % m_modulo) : 0u;
     }
 
-    Task::~Task() = default;
+    Task::~Task()
+    {
+        if (TaskContainer* parent = m_parent.load(std::memory_order_acquire))
+            parent->Forget(*this);
+
+        // Edges outlive Remove, so they are only unlinked here
+        ClearDependencies();
+        for (Task* t : m_dependents)
+        {
+            t->m_dependencies.erase(std::find(t->m_dependencies.begin(), t->m_dependencies.end(), this));
+            if (TaskContainer* parent = t->m_parent.load(std::memory_order_acquire))
+                parent->m_graphDirty.store(true, std::memory_order_release);
+        }
+    }
 
     void Task::Initialize()
     {
@@ -40,7 +66,7 @@ namespace opus::tasks
 
     void Task::UpdateImpl(uint64_t count, bool useInternal)
     {
-        if (!m_enabled)
+        if (!IsEnabled())
             return;
 
         if (!m_initialized)
@@ -53,22 +79,155 @@ namespace opus::tasks
 
         // Gate by modulo/offset
         if (((taskCount + m_offset) % m_modulo) == 0)
+            Dispatch(taskCount);
+    }
+
+    void Task::Dispatch(uint64_t taskCount)
+    {
+        OPUS_PROFILE_SCOPE(Name());
+
+        if (!m_initialized)
+            Initialize();
+
+        OnUpdate(taskCount);
+
+        // Increment count if using internal
+        if (m_internal)
+            ++m_count;
+    }
+
+    void Task::Enable()
+    {
+        if (m_enabled.exchange(true, std::memory_order_relaxed))
+            return;
+
+        if (TaskContainer* parent = m_parent.load(std::memory_order_acquire))
+            parent->m_commands.Push(TaskContainer::Command{TaskContainer::Command::Type::Flag, this, TaskContainer::SLOT_ENABLED, true});
+    }
+
+    void Task::Disable()
+    {
+        if (!m_enabled.exchange(false, std::memory_order_relaxed))
+            return;
+
+        if (TaskContainer* parent = m_parent.load(std::memory_order_acquire))
+            parent->m_commands.Push(TaskContainer::Command{TaskContainer::Command::Type::Flag, this, TaskContainer::SLOT_ENABLED, false});
+    }
+
+    bool Task::DependsOn(Task& task)
+    {
+        if (&task == this)
+            return false;
+
+        if (std::find(m_dependencies.begin(), m_dependencies.end(), &task) != m_dependencies.end())
+            return false;
+
+        // Refuse the edge if task already waits on this one, directly or not
+        opus::memory::FrameArena& arena = opus::memory::GetFrameArena();
+        const opus::memory::ArenaScope scratch(arena);
+        opus::memory::ArenaVector<const Task*> stack{opus::memory::ArenaAllocator<const Task*>(arena)};
+        opus::memory::ArenaVector<const Task*> visited{opus::memory::ArenaAllocator<const Task*>(arena)};
+        stack.push_back(&task);
+        while (!stack.empty())
         {
-            OnUpdate(taskCount);
+            const Task* t = stack.back();
+            stack.pop_back();
+            if (t == this)
+                return false;
 
-            // Increment count if using internal
-            if (m_internal)
-                ++m_count;
+            if (std::find(visited.begin(), visited.end(), t) != visited.end())
+                continue;
+
+            visited.push_back(t);
+            stack.insert(stack.end(), t->m_dependencies.begin(), t->m_dependencies.end());
         }
+
+        m_dependencies.push_back(&task);
+        task.m_dependents.push_back(this);
+        if (TaskContainer* parent = m_parent.load(std::memory_order_acquire))
+            parent->m_graphDirty.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void Task::ClearDependencies()
+    {
+        for (Task* t : m_dependencies)
+            t->m_dependents.erase(std::find(t->m_dependents.begin(), t->m_dependents.end(), this));
+
+        m_dependencies.clear();
+        if (TaskContainer* parent = m_parent.load(std::memory_order_acquire))
+            parent->m_graphDirty.store(true, std::memory_order_release);
+    }
+
+    void Task::ResetCount()
+    {
+        m_count = 0;
+        if (TaskContainer* parent = m_parent.load(std::memory_order_acquire))
+            parent->m_commands.Push(TaskContainer::Command{TaskContainer::Command::Type::ResetCount, this});
     }
 
-    void Task::Enable()  { m_enabled = true; }
-    void Task::Disable() { m_enabled = false; }
-    void Task::ResetCount() { m_count = 0; }
-    bool Task::IsEnabled() const { return m_enabled; }
+    void Task::SetIndependent(bool independent)
+    {
+        if (m_independent.exchange(independent, std::memory_order_relaxed) == independent)
+            return;
+
+        if (TaskContainer* parent = m_parent.load(std::memory_order_acquire))
+            parent->m_commands.Push(TaskContainer::Command{TaskContainer::Command::Type::Flag, this, TaskContainer::SLOT_INDEPENDENT, independent});
+    }
+
+    void Task::SetName(const char* name) { m_name = name; }
+    bool Task::IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
     bool Task::IsInternal() const { return m_internal; }
     bool Task::IsInitialized() const { return m_initialized; }
+    bool Task::IsIndependent() const { return m_independent.load(std::memory_order_relaxed); }
     uint64_t Task::Count() const { return m_count; }
+    uint32_t Task::Modulo() const { return m_modulo; }
+    uint32_t Task::Offset() const { return m_offset; }
+    const std::vector<Task*>& Task::Dependencies() const { return m_dependencies; }
+    TaskContainer* Task::GetParent() const { return m_parent.load(std::memory_order_acquire); }
+
+    namespace
+    {
+        // Readable class names, one per type. A deque keeps each string in
+        // place as it grows: the profiler holds the pointers until export.
+        const char* TypeName(const std::type_info& type)
+        {
+            static std::mutex mutex;
+            static std::deque<std::pair<const std::type_info*, std::string>> names;
+
+            const std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& [info, name] : names)
+            {
+                if (*info == type)
+                    return name.c_str();
+            }
+
+            std::string name = type.name(); // MSVC's is readable already
+#if defined(__GNUC__)
+            int status = 0;
+            if (char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status))
+            {
+                name = demangled;
+                std::free(demangled);
+            }
+#endif
+            return names.emplace_back(&type, std::move(name)).second.c_str();
+        }
+    }
+
+    const char* Task::Name() const
+    {
+        if (m_name)
+            return m_name;
+
+        const char* name = m_typeName.load(std::memory_order_acquire);
+        if (!name)
+        {
+            name = TypeName(typeid(*this));
+            m_typeName.store(name, std::memory_order_release);
+        }
+        return name;
+    }
 }
 
 // Clase Task Container 
@@ -84,32 +243,690 @@ namespace opus::tasks
     {
     }
 
+    TaskContainer::~TaskContainer()
+    {
+        ApplyPending();
+        for (Task* t : m_tasks)
+        {
+            if (!t)
+                continue;
+
+            t->m_attached = false;
+            t->m_removing.store(false, std::memory_order_relaxed);
+            t->m_parent.store(nullptr, std::memory_order_release);
+        }
+    }
+
     bool TaskContainer::AddTask(Task& task)
     {
-        auto it = std::find(m_tasks.begin(), m_tasks.end(), &task);
-        if (it != m_tasks.end())
+        if (&task == this)
             return false;
 
-        m_tasks.push_back(&task);
+        // A task belongs to at most one container (this also rejects duplicates),
+        // unless it is ours with a Remove still queued: the Add cancels that
+        TaskContainer* expected = nullptr;
+        if (!task.m_parent.compare_exchange_strong(expected, this, std::memory_order_acq_rel) &&
+            (expected != this || !task.m_removing.exchange(false, std::memory_order_acq_rel)))
+            return false;
+
+        m_commands.Push(Command{Command::Type::Add, &task});
         return true;
     }
 
     bool TaskContainer::RemoveTask(Task& task)
     {
-        auto it = std::remove(m_tasks.begin(), m_tasks.end(), &task);
-        if (it == m_tasks.end())
+        if (task.m_parent.load(std::memory_order_acquire) != this)
             return false;
 
-        m_tasks.erase(it, m_tasks.end());
+        task.m_removing.store(true, std::memory_order_release);
+        m_commands.Push(Command{Command::Type::Remove, &task});
         return true;
     }
 
+    void TaskContainer::ApplyPending()
+    {
+        if (!m_commands.IsEmpty())
+        {
+            m_commands.Drain([this](Command&& command)
+            {
+                Task& task = *command.task;
+                switch (command.type)
+                {
+                case Command::Type::Add:
+                    Attach(task);
+                    break;
+                case Command::Type::Remove:
+                    if (task.m_removing.exchange(false, std::memory_order_acq_rel))
+                        Detach(task); // Not cancelled by a later Add
+                    break;
+                case Command::Type::Flag:
+                    if (task.m_attached && task.m_parent.load(std::memory_order_relaxed) == this)
+                        SetSlotFlag(task.m_slot, command.flag, command.value);
+                    break;
+                case Command::Type::ResetCount:
+                    if (task.m_attached && task.m_parent.load(std::memory_order_relaxed) == this)
+                        m_counts[task.m_slot] = 0;
+                    break;
+                }
+            });
+        }
+
+        Compact();
+    }
+
+    void TaskContainer::Attach(Task& task)
+    {
+        if (task.m_attached || task.m_parent.load(std::memory_order_acquire) != this)
+            return;
+
+        const uint32_t slot = uint32_t(m_tasks.size());
+        m_tasks.push_back(&task);
+        m_modulos.push_back(task.m_modulo);
+        m_offsets.push_back(task.m_offset);
+        m_counts.push_back(task.m_count);
+        m_waves.push_back(0);
+        const bool enabled = task.IsEnabled();
+        m_flags.push_back(uint8_t((enabled ? SLOT_ENABLED : 0) |
+                                  (task.m_internal ? SLOT_INTERNAL : 0) |
+                                  (task.IsIndependent() ? SLOT_INDEPENDENT : 0)));
+
+        task.m_attached = true;
+        task.m_slot = slot;
+        m_graphDirty.store(true, std::memory_order_relaxed);
+
+        if (enabled)
+            Index(slot);
+    }
+
+    void TaskContainer::Detach(Task& task)
+    {
+        if (!task.m_attached)
+            return;
+
+        // Clear the slot; it is squeezed out by the next Compact
+        const uint32_t slot = task.m_slot;
+        if (m_flags[slot] & SLOT_ENABLED)
+            Unindex(slot);
+
+        m_tasks[slot] = nullptr;
+        m_flags[slot] = 0;
+        m_compact = true;
+
+        task.m_attached = false;
+        task.m_parent.store(nullptr, std::memory_order_release);
+
+        // Edges to and from the task are kept for a later Add; BuildGraph
+        // skips those naming a task that is no longer ours
+        m_graphDirty.store(true, std::memory_order_relaxed);
+    }
+
+    void TaskContainer::Forget(Task& task)
+    {
+        // Settle queued commands that may still name the task, then drop it
+        // right away. Also covers a sibling destroyed during this update: its
+        // slot is cleared, so the pending visit is skipped.
+        ApplyPending();
+        Detach(task);
+        task.m_removing.store(false, std::memory_order_relaxed);
+        task.m_parent.store(nullptr, std::memory_order_release);
+    }
+
+    void TaskContainer::Compact()
+    {
+        if (!m_compact || m_updating)
+            return;
+
+        // Keep insertion order; slots only move here, outside of an update
+        uint32_t write = 0;
+        for (uint32_t read = 0; read < m_tasks.size(); ++read)
+        {
+            if (!m_tasks[read])
+                continue;
+
+            m_tasks[write] = m_tasks[read];
+            m_modulos[write] = m_modulos[read];
+            m_offsets[write] = m_offsets[read];
+            m_counts[write] = m_counts[read];
+            m_waves[write] = m_waves[read];
+            m_flags[write] = m_flags[read];
+            m_tasks[write]->m_slot = write;
+            ++write;
+        }
+
+        m_tasks.resize(write);
+        m_modulos.resize(write);
+        m_offsets.resize(write);
+        m_counts.resize(write);
+        m_waves.resize(write);
+        m_flags.resize(write);
+
+        for (ModuloGroup& group : m_groups)
+            group.entries.clear();
+        m_selfClocked.clear();
+        for (uint32_t slot = 0; slot < write; ++slot)
+        {
+            if (m_flags[slot] & SLOT_ENABLED)
+                Index(slot);
+        }
+
+        m_compact = false;
+    }
+
+    void TaskContainer::SetSlotFlag(uint32_t slot, uint8_t flag, bool value)
+    {
+        const bool wasEnabled = (m_flags[slot] & SLOT_ENABLED) != 0;
+        m_flags[slot] = value ? uint8_t(m_flags[slot] | flag) : uint8_t(m_flags[slot] & ~flag);
+
+        const bool isEnabled = (m_flags[slot] & SLOT_ENABLED) != 0;
+        if (isEnabled && !wasEnabled)
+            Index(slot);
+        else if (!isEnabled && wasEnabled)
+            Unindex(slot);
+    }
+
+    bool TaskContainer::SetExecutionMode(ExecutionMode mode)
+    {
+        m_mode = mode;
+        return mode != ExecutionMode::Graph || BuildGraph();
+    }
+
+    void TaskContainer::SetJobPool(opus::jobs::JobPool* pool) { m_pool = pool; }
+    ExecutionMode TaskContainer::GetExecutionMode() const { return m_mode; }
+    bool TaskContainer::IsGraphValid() const { return m_graphValid; }
+    const std::vector<Task*>& TaskContainer::CycleTasks() const { return m_cycle; }
+
+    bool TaskContainer::BuildGraph()
+    {
+        ApplyPending();
+
+        // Kahn's algorithm, one wave at a time; ties keep insertion order.
+        // Dependencies on tasks outside this container (or removed from it)
+        // are ignored. The
+        // scratch comes from the frame arena and goes back on return.
+        opus::memory::FrameArena& arena = opus::memory::GetFrameArena();
+        const opus::memory::ArenaScope scratch(arena);
+
+        const uint32_t numSlots = uint32_t(m_tasks.size());
+        const auto slotOf = [this, numSlots](const Task* dep)
+        {
+            const bool ours = dep->m_parent.load(std::memory_order_acquire) == this && dep->m_attached &&
+                              dep->m_slot < numSlots && m_tasks[dep->m_slot] == dep;
+            return ours ? dep->m_slot : numSlots;
+        };
+
+        // Dependents of slot i are edges[first[i]] to edges[first[i + 1]]
+        uint32_t* pending = arena.AllocateArray<uint32_t>(numSlots);
+        uint32_t* first = arena.AllocateArray<uint32_t>(numSlots + 1);
+        std::fill_n(pending, numSlots, 0u);
+        std::fill_n(first, numSlots + 1, 0u);
+
+        size_t numTasks = 0;
+        for (uint32_t i = 0; i < numSlots; ++i)
+        {
+            if (!m_tasks[i])
+                continue;
+
+            ++numTasks;
+            for (const Task* dep : m_tasks[i]->m_dependencies)
+            {
+                const uint32_t d = slotOf(dep);
+                if (d == numSlots)
+                    continue;
+
+                ++first[d + 1];
+                ++pending[i];
+            }
+        }
+
+        for (uint32_t i = 0; i < numSlots; ++i)
+            first[i + 1] += first[i];
+
+        uint32_t* edges = arena.AllocateArray<uint32_t>(first[numSlots]);
+        uint32_t* fill = arena.AllocateArray<uint32_t>(numSlots);
+        std::copy_n(first, numSlots, fill);
+        for (uint32_t i = 0; i < numSlots; ++i)
+        {
+            if (!m_tasks[i])
+                continue;
+
+            for (const Task* dep : m_tasks[i]->m_dependencies)
+            {
+                const uint32_t d = slotOf(dep);
+                if (d != numSlots)
+                    edges[fill[d]++] = i;
+            }
+        }
+
+        uint32_t* wave = arena.AllocateArray<uint32_t>(numSlots);
+        uint32_t* next = arena.AllocateArray<uint32_t>(numSlots);
+        uint32_t waveSize = 0;
+        for (uint32_t i = 0; i < numSlots; ++i)
+        {
+            if (m_tasks[i] && pending[i] == 0)
+                wave[waveSize++] = i;
+        }
+
+        uint32_t waveIndex = 0;
+        size_t ordered = 0;
+        while (waveSize != 0)
+        {
+            uint32_t nextSize = 0;
+            for (uint32_t w = 0; w < waveSize; ++w)
+            {
+                const uint32_t i = wave[w];
+                m_waves[i] = waveIndex;
+                for (uint32_t e = first[i]; e < first[i + 1]; ++e)
+                {
+                    if (--pending[edges[e]] == 0)
+                        next[nextSize++] = edges[e];
+                }
+            }
+            ordered += waveSize;
+            std::sort(next, next + nextSize);
+            std::swap(wave, next);
+            waveSize = nextSize;
+            ++waveIndex;
+        }
+
+        // Whatever is left sits on a cycle or depends on one
+        m_cycle.clear();
+        for (uint32_t i = 0; i < numSlots; ++i)
+        {
+            if (m_tasks[i] && pending[i] != 0)
+            {
+                m_waves[i] = waveIndex;
+                m_cycle.push_back(m_tasks[i]);
+            }
+        }
+
+        m_cycleWave = waveIndex;
+        m_graphValid = (ordered == numTasks);
+        m_graphDirty.store(false, std::memory_order_relaxed);
+        return m_graphValid;
+    }
+
     void TaskContainer::OnUpdate(uint64_t count)
     {
-        for (Task* t : m_tasks)
+        // Safe point: nothing below iterates the containers being changed
+        ApplyPending();
+
+        m_updating = true;
+        CollectDue(count);
+
+        if (m_mode == ExecutionMode::Graph)
         {
-            if (t)
-                t->Update(count);
+            RunWaves(count);
         }
+        else if (m_mode == ExecutionMode::Serial || !m_pool)
+        {
+            for (uint32_t slot : m_due)
+                RunChild(slot, count);
+        }
+        else
+        {
+            RunIndependent(count);
+        }
+        m_updating = false;
+    }
+
+    void TaskContainer::RunIndependent(uint64_t count)
+    {
+        // Consecutive independent children form a batch; any other child is a
+        // barrier, so it still runs after everything added before it.
+        m_batch.clear();
+        for (uint32_t slot : m_due)
+        {
+            if (m_flags[slot] & SLOT_INDEPENDENT)
+            {
+                m_batch.push_back(slot);
+                continue;
+            }
+
+            RunBatch(count);
+            RunChild(slot, count);
+        }
+        RunBatch(count);
+    }
+
+    void TaskContainer::RunWaves(uint64_t count)
+    {
+        // A cycle leaves the graph invalid; its children are held back rather
+        // than run in an arbitrary order, until the edges are fixed
+        if (m_graphDirty.load(std::memory_order_acquire))
+            BuildGraph();
+
+        std::sort(m_due.begin(), m_due.end(), [this](uint32_t a, uint32_t b)
+        {
+            return m_waves[a] != m_waves[b] ? m_waves[a] < m_waves[b] : a < b;
+        });
+
+        size_t begin = 0;
+        while (begin < m_due.size())
+        {
+            const uint32_t wave = m_waves[m_due[begin]];
+            size_t end = begin + 1;
+            while (end < m_due.size() && m_waves[m_due[end]] == wave)
+                ++end;
+
+            if (!m_graphValid && wave == m_cycleWave)
+                break; // Always the last wave
+
+            if (m_pool)
+            {
+                m_batch.assign(m_due.begin() + begin, m_due.begin() + end);
+                RunBatch(count);
+            }
+            else
+            {
+                for (size_t i = begin; i < end; ++i)
+                    RunChild(m_due[i], count);
+            }
+            begin = end;
+        }
+    }
+
+    void TaskContainer::RunBatch(uint64_t count)
+    {
+        if (m_batch.size() == 1)
+            RunChild(m_batch.front(), count);
+        else if (!m_batch.empty())
+            m_pool->ParallelFor(uint32_t(m_batch.size()), [this, count](uint32_t i) { RunChild(m_batch[i], count); });
+
+        m_batch.clear();
+    }
+
+    // Schedule Index
+    namespace
+    {
+        template <typename T>
+        void InsertSorted(std::vector<T>& values, T value)
+        {
+            values.insert(std::upper_bound(values.begin(), values.end(), value), value);
+        }
+
+        template <typename T>
+        void EraseSorted(std::vector<T>& values, T value)
+        {
+            auto it = std::lower_bound(values.begin(), values.end(), value);
+            if (it != values.end() && *it == value)
+                values.erase(it);
+        }
+
+        uint64_t ResidueKey(uint32_t residue, uint32_t slot)
+        {
+            return (uint64_t(residue) << 32) | slot;
+        }
+    }
+
+    void TaskContainer::Index(uint32_t slot)
+    {
+        if (m_flags[slot] & SLOT_INTERNAL)
+        {
+            InsertSorted(m_selfClocked, slot);
+            return;
+        }
+
+        const uint32_t modulo = m_modulos[slot];
+        auto group = std::find_if(m_groups.begin(), m_groups.end(),
+                                  [modulo](const ModuloGroup& g) { return g.modulo == modulo; });
+        if (group == m_groups.end())
+            group = m_groups.insert(m_groups.end(), ModuloGroup{modulo, {}});
+
+        const uint32_t residue = (modulo - m_offsets[slot]) % modulo;
+        InsertSorted(group->entries, ResidueKey(residue, slot));
+    }
+
+    void TaskContainer::Unindex(uint32_t slot)
+    {
+        if (m_flags[slot] & SLOT_INTERNAL)
+        {
+            EraseSorted(m_selfClocked, slot);
+            return;
+        }
+
+        const uint32_t modulo = m_modulos[slot];
+        auto group = std::find_if(m_groups.begin(), m_groups.end(),
+                                  [modulo](const ModuloGroup& g) { return g.modulo == modulo; });
+        if (group != m_groups.end())
+            EraseSorted(group->entries, ResidueKey((modulo - m_offsets[slot]) % modulo, slot));
+    }
+
+    void TaskContainer::CollectDue(uint64_t count)
+    {
+        // Internal-count children gate on their own count, straight from the
+        // packed arrays without touching the Task objects
+        m_due.clear();
+        for (uint32_t slot : m_selfClocked)
+        {
+            if (((m_counts[slot] + m_offsets[slot]) % m_modulos[slot]) == 0)
+                m_due.push_back(slot);
+        }
+        size_t sources = m_due.empty() ? 0 : 1;
+
+        // One modulo per distinct period instead of one per child
+        for (const ModuloGroup& group : m_groups)
+        {
+            const uint64_t key = ResidueKey(uint32_t(count % group.modulo), 0);
+            auto it = std::lower_bound(group.entries.begin(), group.entries.end(), key);
+            if (it == group.entries.end() || (*it >> 32) != (key >> 32))
+                continue;
+
+            for (; it != group.entries.end() && (*it >> 32) == (key >> 32); ++it)
+                m_due.push_back(uint32_t(*it));
+            ++sources;
+        }
+
+        // Each run is already ordered; only interleaved runs need sorting
+        if (sources > 1)
+            std::sort(m_due.begin(), m_due.end());
+    }
+
+    void TaskContainer::RunChild(uint32_t slot, uint64_t count)
+    {
+        // Skip children destroyed or disabled by a sibling earlier this tick;
+        // the slot flag itself only changes between passes
+        Task* task = m_tasks[slot];
+        if (!task || !(m_flags[slot] & SLOT_ENABLED) || !task->IsEnabled())
+            return;
+
+        if (m_flags[slot] & SLOT_INTERNAL)
+        {
+            task->Dispatch(m_counts[slot]);
+            ++m_counts[slot];
+        }
+        else
+        {
+            task->Dispatch(count);
+        }
+    }
+}
+
+// Class Deferrable Task
+namespace opus::tasks
+{
+    DeferrableTask::DeferrableTask()
+        : Task(1, 0, true, false)
+    {
+    }
+
+    DeferrableTask::DeferrableTask(uint32_t priority, uint32_t modulo, uint32_t offset, bool enabled)
+        : Task(modulo, offset, enabled, false),
+          m_priority(priority)
+    {
+    }
+
+    DeferrableTask::~DeferrableTask()
+    {
+        if (DeferredTaskContainer* queue = m_queue.load(std::memory_order_acquire))
+            queue->Forget(*this);
+    }
+
+    void DeferrableTask::SetPriority(uint32_t priority) { m_priority = priority; }
+    uint32_t DeferrableTask::Priority() const { return m_priority; }
+    bool DeferrableTask::IsPending() const { return m_pending; }
+    uint64_t DeferrableTask::CostNs() const { return m_costNs; }
+    DeferredTaskContainer* DeferrableTask::GetQueue() const { return m_queue.load(std::memory_order_acquire); }
+}
+
+// Class Deferred Task Container
+namespace opus::tasks
+{
+    DeferredTaskContainer::DeferredTaskContainer()
+        : Task(1, 0, true, false)
+    {
+    }
+
+    DeferredTaskContainer::~DeferredTaskContainer()
+    {
+        ApplyPending();
+        for (DeferrableTask* t : m_tasks)
+        {
+            t->m_attached = false;
+            t->m_removing.store(false, std::memory_order_relaxed);
+            t->m_queue.store(nullptr, std::memory_order_release);
+        }
+    }
+
+    bool DeferredTaskContainer::AddTask(DeferrableTask& task)
+    {
+        // Same ownership rules as TaskContainer::AddTask
+        DeferredTaskContainer* expected = nullptr;
+        if (!task.m_queue.compare_exchange_strong(expected, this, std::memory_order_acq_rel) &&
+            (expected != this || !task.m_removing.exchange(false, std::memory_order_acq_rel)))
+            return false;
+
+        m_commands.Push(Command{Command::Type::Add, &task});
+        return true;
+    }
+
+    bool DeferredTaskContainer::RemoveTask(DeferrableTask& task)
+    {
+        if (task.m_queue.load(std::memory_order_acquire) != this)
+            return false;
+
+        task.m_removing.store(true, std::memory_order_release);
+        m_commands.Push(Command{Command::Type::Remove, &task});
+        return true;
+    }
+
+    void DeferredTaskContainer::ApplyPending()
+    {
+        if (m_commands.IsEmpty())
+            return;
+
+        m_commands.Drain([this](Command&& command)
+        {
+            DeferrableTask& task = *command.task;
+            if (command.type == Command::Type::Add)
+                Attach(task);
+            else if (task.m_removing.exchange(false, std::memory_order_acq_rel))
+                Detach(task); // Not cancelled by a later Add
+        });
+    }
+
+    void DeferredTaskContainer::Attach(DeferrableTask& task)
+    {
+        if (task.m_attached || task.m_queue.load(std::memory_order_acquire) != this)
+            return;
+
+        task.m_attached = true;
+        task.m_pending = false;
+        m_tasks.push_back(&task);
+    }
+
+    void DeferredTaskContainer::Detach(DeferrableTask& task)
+    {
+        if (!task.m_attached)
+            return;
+
+        m_tasks.erase(std::find(m_tasks.begin(), m_tasks.end(), &task));
+        if (task.m_pending)
+        {
+            // The run loop walks m_pending; leave a hole it skips and squeezes out
+            auto it = std::find(m_pending.begin(), m_pending.end(), &task);
+            if (m_running)
+                *it = nullptr;
+            else
+                m_pending.erase(it);
+        }
+
+        task.m_attached = false;
+        task.m_pending = false;
+        task.m_queue.store(nullptr, std::memory_order_release);
+    }
+
+    void DeferredTaskContainer::Forget(DeferrableTask& task)
+    {
+        ApplyPending();
+        Detach(task);
+        task.m_removing.store(false, std::memory_order_relaxed);
+        task.m_queue.store(nullptr, std::memory_order_release);
+    }
+
+    void DeferredTaskContainer::SetDeadline(uint64_t deadlineNs) { m_deadlineNs = deadlineNs; }
+    uint64_t DeferredTaskContainer::Deadline() const { return m_deadlineNs; }
+    size_t DeferredTaskContainer::NumPending() const { return m_pending.size(); }
+
+    void DeferredTaskContainer::OnUpdate(uint64_t count)
+    {
+        ApplyPending();
+
+        // Queue newly due work; a task still pending from an earlier tick keeps its place
+        bool added = false;
+        for (DeferrableTask* t : m_tasks)
+        {
+            if (t->m_pending || !t->IsEnabled() || ((count + t->Offset()) % t->Modulo()) != 0)
+                continue;
+
+            t->m_pending = true;
+            t->m_pendingCount = count;
+            t->m_pendingOrder = m_nextOrder++;
+            m_pending.push_back(t);
+            added = true;
+        }
+
+        if (added)
+        {
+            std::sort(m_pending.begin(), m_pending.end(), [](const DeferrableTask* a, const DeferrableTask* b)
+            {
+                return a->m_priority != b->m_priority ? a->m_priority > b->m_priority
+                                                      : a->m_pendingOrder < b->m_pendingOrder;
+            });
+        }
+
+        // Spend the budget. Work whose usual cost would overrun the deadline is
+        // passed over for cheaper work behind it; each time it is, the estimate
+        // it is judged by halves, so it is tried again within a few ticks.
+        m_running = true;
+        for (DeferrableTask*& slot : m_pending)
+        {
+            DeferrableTask* t = slot;
+            if (!t)
+                continue; // Removed by a task that ran before it
+
+            if (t->m_removing.load(std::memory_order_acquire))
+                continue; // Dropped at the next ApplyPending
+
+            const uint64_t begin = opus::profiler::NowNs();
+            if (t->IsEnabled() && m_deadlineNs != 0 && begin + (t->m_costNs >> t->m_skips) >= m_deadlineNs)
+            {
+                t->m_skips = std::min(t->m_skips + 1, 63u);
+                continue;
+            }
+
+            slot = nullptr;
+            t->m_pending = false;
+            t->m_skips = 0;
+            if (!t->IsEnabled())
+                continue;
+
+            t->Dispatch(t->m_pendingCount);
+
+            const uint64_t cost = opus::profiler::NowNs() - begin;
+            t->m_costNs = t->m_costNs ? (t->m_costNs * 7 + cost) / 8 : cost;
+        }
+        m_running = false;
+
+        m_pending.erase(std::remove(m_pending.begin(), m_pending.end(), nullptr), m_pending.end());
     }
 }
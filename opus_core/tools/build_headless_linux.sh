@@ -0,0 +1,95 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# ------------------------------------------------------------
+# Project paths (derived from this script location)
+# ------------------------------------------------------------
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "${SCRIPT_DIR}/.." && pwd)"
+INC_ROOT="${PROJECT_ROOT}/include"
+
+CONFIG="${1:-Release}"
+CXX="${CXX:-g++}"
+COUNT_HEAP="${COUNT_HEAP:-0}" # 1: opus_bench counts every heap allocation
+OUT_DIR="${PROJECT_ROOT}/build/linux/${CONFIG}"
+
+case "${CONFIG}" in
+  Release) OPT_FLAGS="-O2 -DNDEBUG" ;;
+  Debug)   OPT_FLAGS="-O0 -g" ;;
+  *)
+    echo "ERROR: unknown config ${CONFIG} (Release or Debug)"
+    exit 1
+    ;;
+esac
+
+mkdir -p "${OUT_DIR}"
+
+echo
+echo "[Opus Linux ${CONFIG} Build]"
+echo "  PROJECT_ROOT = ${PROJECT_ROOT}"
+echo "  OUT_DIR      = ${OUT_DIR}"
+echo
+
+cd "${PROJECT_ROOT}"
+
+# ------------------------------------------------------------
+# Opus libretro core (shared object)
+# ------------------------------------------------------------
+${CXX} -std=c++20 ${OPT_FLAGS} -fPIC -shared -pthread \
+  -I "${INC_ROOT}" \
+  src/opus_libretro.cpp \
+  src/opus_tasks.cpp \
+  src/opus_jobs.cpp \
+  src/opus_profiler.cpp \
+  src/opus_coroutine.cpp \
+  src/opus_gfx.cpp \
+  src/opus_kernels.cpp \
+  src/opus_memory.cpp \
+  -o "${OUT_DIR}/opus_libretro.so"
+
+# ------------------------------------------------------------
+# Headless frontend / benchmark harness
+# ------------------------------------------------------------
+${CXX} -std=c++20 ${OPT_FLAGS} \
+  -I "${INC_ROOT}" \
+  tools/opus_headless.cpp \
+  -ldl \
+  -o "${OUT_DIR}/opus_headless"
+
+# ------------------------------------------------------------
+# Kernel micro-benchmarks
+# ------------------------------------------------------------
+${CXX} -std=c++20 ${OPT_FLAGS} -pthread -DOPUS_BENCH_COUNT_HEAP=${COUNT_HEAP} \
+  -I "${INC_ROOT}" \
+  tools/opus_bench.cpp \
+  src/opus_tasks.cpp \
+  src/opus_jobs.cpp \
+  src/opus_profiler.cpp \
+  src/opus_coroutine.cpp \
+  src/opus_gfx.cpp \
+  src/opus_kernels.cpp \
+  src/opus_memory.cpp \
+  -o "${OUT_DIR}/opus_bench"
+
+# ------------------------------------------------------------
+# Behaviour tests (asserts stay on in Release)
+# ------------------------------------------------------------
+${CXX} -std=c++20 ${OPT_FLAGS} -pthread \
+  -I "${INC_ROOT}" \
+  tools/opus_tests.cpp \
+  src/opus_tasks.cpp \
+  src/opus_jobs.cpp \
+  src/opus_profiler.cpp \
+  src/opus_coroutine.cpp \
+  src/opus_gfx.cpp \
+  src/opus_kernels.cpp \
+  src/opus_memory.cpp \
+  -o "${OUT_DIR}/opus_tests"
+
+"${OUT_DIR}/opus_tests"
+
+echo "Built:"
+echo "  ${OUT_DIR}/opus_libretro.so"
+echo "  ${OUT_DIR}/opus_headless"
+echo "  ${OUT_DIR}/opus_bench"
+echo "  ${OUT_DIR}/opus_tests"
@@ -0,0 +1,1276 @@
+// opus_bench.cpp - micro-benchmarks for the Opus surface kernels
+//
+// Times each kernel on every instruction set the CPU supports, in every
+// pixel format, against the per-pixel loop the core used to draw its
+// checkerboard with, plus the indexed-to-RGB palette expansion, the batch
+// format converters, sprite blits, a scrolling tile map, banded scene
+// drawing on 1..N threads (immediate and through a recorded display list),
+// depth sorting, culling, the frame arena and object pools, heap traffic of
+// whole frames in Parallel and Graph mode, static against virtual task
+// dispatch, and coroutine tasks against hand-written state machines. Kernel
+// output is checked against a plain loop (or the scalar kernels, for
+// blits) first.
+//
+//   opus_bench [--size WxH] [--iterations N]
+//
+// Built with OPUS_BENCH_COUNT_HEAP=1, every heap allocation is counted (the
+// standard containers' too), not only the blocks opus::memory hands out.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "opus_coroutine.h"
+#include "opus_gfx.h"
+#include "opus_jobs.h"
+#include "opus_kernels.h"
+#include "opus_memory.h"
+#include "opus_static_tasks.h"
+#include "opus_tasks.h"
+
+using opus::gfx::PixelFormat;
+using opus::gfx::Rect;
+using opus::gfx::Surface;
+namespace kernels = opus::gfx::kernels;
+
+// ------------------------------------------------------------
+// Config
+// ------------------------------------------------------------
+static constexpr uint32_t TILE_W = 8;
+static constexpr uint32_t TILE_H = 8;
+
+static constexpr uint32_t RGB565_RED    = 0xF800;
+static constexpr uint32_t RGB565_BLUE   = 0x001F;
+static constexpr uint32_t XRGB8888_RED  = 0x00FF0000;
+static constexpr uint32_t XRGB8888_BLUE = 0x000000FF;
+static constexpr uint32_t INDEX_RED     = 1;
+static constexpr uint32_t INDEX_BLUE    = 2;
+
+static constexpr uint32_t SPRITE_SIZE  = 32;
+static constexpr uint32_t SPRITE_COUNT = 256;
+
+static constexpr uint32_t MAP_TILE = 16;
+static constexpr uint32_t MAP_SIZE = 64; // Tiles per side
+
+static constexpr uint32_t SCENE_SPRITES = 2000;
+
+static uint32_t g_width      = 320;
+static uint32_t g_height     = 240;
+static unsigned g_iterations = 2000;
+
+// ------------------------------------------------------------
+// Reference: the original render_checkerboard_rgb565 loop
+// ------------------------------------------------------------
+template <typename Pixel>
+static void checkerboard_loop(const Surface& target, Pixel a, Pixel b)
+{
+   for (uint32_t y = 0; y < target.GetHeight(); ++y)
+   {
+      Pixel* row = target.GetRowAs<Pixel>(y);
+      const uint32_t ty = (y / TILE_H);
+      for (uint32_t x = 0; x < target.GetWidth(); ++x)
+      {
+         const uint32_t tx = (x / TILE_W);
+         const bool even = ((tx + ty) & 1) == 0;
+         row[x] = even ? a : b;
+      }
+   }
+}
+
+// ------------------------------------------------------------
+// Heap accounting
+// ------------------------------------------------------------
+// Off by default: the counter would sit inside every allocation the other
+// benches time.
+#ifndef OPUS_BENCH_COUNT_HEAP
+#define OPUS_BENCH_COUNT_HEAP 0
+#endif
+
+#if OPUS_BENCH_COUNT_HEAP
+static std::atomic<uint64_t> g_heap_allocations{0};
+
+void* operator new(size_t size)
+{
+   g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+   if (void* block = std::malloc(size ? size : 1))
+      return block;
+   throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+   g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+   const size_t align = std::max(size_t(alignment), sizeof(void*));
+   if (void* block = std::aligned_alloc(align, (size + align - 1) / align * align))
+      return block;
+   throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete(void* block, size_t) noexcept { std::free(block); }
+void operator delete(void* block, std::align_val_t) noexcept { std::free(block); }
+void operator delete(void* block, size_t, std::align_val_t) noexcept { std::free(block); }
+void operator delete[](void* block) noexcept { std::free(block); }
+void operator delete[](void* block, size_t) noexcept { std::free(block); }
+void operator delete[](void* block, std::align_val_t) noexcept { std::free(block); }
+void operator delete[](void* block, size_t, std::align_val_t) noexcept { std::free(block); }
+
+static uint64_t heap_allocations() { return g_heap_allocations.load(std::memory_order_relaxed); }
+#else
+static uint64_t heap_allocations() { return opus::memory::GetStats().allocations; }
+#endif
+
+// ------------------------------------------------------------
+// Harness
+// ------------------------------------------------------------
+static double g_baseline_ns = 0.0;
+
+static double time_ns(const std::function<void()>& body)
+{
+   using clock = std::chrono::steady_clock;
+
+   for (unsigned i = 0; i < g_iterations / 10 + 1; ++i)
+      body();
+
+   const clock::time_point begin = clock::now();
+   for (unsigned i = 0; i < g_iterations; ++i)
+      body();
+   return std::chrono::duration<double, std::nano>(clock::now() - begin).count() / g_iterations;
+}
+
+static void report(const char* name, const char* isa, double ns, double pixels)
+{
+   // Speed-up only means something for whole-frame work
+   std::printf("  %-22s %-7s %10.1f ns  %9.1f MPix/s", name, isa, ns, pixels * 1e3 / ns);
+   if (g_baseline_ns > 0.0 && pixels == double(g_width) * g_height)
+      std::printf("  x%.1f", g_baseline_ns / ns);
+   std::printf("\n");
+}
+
+static bool same_pixels(const Surface& a, const Surface& b)
+{
+   const size_t row = size_t(a.GetWidth()) * opus::gfx::BytesPerPixel(a.GetFormat());
+   for (uint32_t y = 0; y < a.GetHeight(); ++y)
+   {
+      if (std::memcmp(a.GetRow(y), b.GetRow(y), row) != 0)
+         return false;
+   }
+   return true;
+}
+
+static const char* format_name(PixelFormat format)
+{
+   switch (format)
+   {
+   case PixelFormat::XRGB8888: return "XRGB8888";
+   case PixelFormat::Indexed8: return "Indexed8";
+   case PixelFormat::XRGB1555: return "0RGB1555";
+   default: return "RGB565";
+   }
+}
+
+static bool bench_format(PixelFormat format)
+{
+   const bool wide = format == PixelFormat::XRGB8888;
+   const bool indexed = format == PixelFormat::Indexed8;
+   const uint32_t red  = indexed ? INDEX_RED : wide ? XRGB8888_RED : RGB565_RED;
+   const uint32_t blue = indexed ? INDEX_BLUE : wide ? XRGB8888_BLUE : RGB565_BLUE;
+   const double pixels = double(g_width) * g_height;
+
+   Surface reference(g_width, g_height, format);
+   Surface target(g_width, g_height, format);
+   const Rect bounds = target.GetBounds();
+   const Rect box{int32_t(g_width / 4), int32_t(g_height / 4), 64, 64};
+
+   std::printf("%s %ux%u, pitch %zu\n", format_name(format), g_width, g_height, target.GetPitch());
+
+   g_baseline_ns = 0.0;
+   const double baseline = indexed
+      ? time_ns([&] { checkerboard_loop<uint8_t>(reference, uint8_t(red), uint8_t(blue)); })
+      : wide ? time_ns([&] { checkerboard_loop<uint32_t>(reference, red, blue); })
+             : time_ns([&] { checkerboard_loop<uint16_t>(reference, uint16_t(red), uint16_t(blue)); });
+   report("checkerboard loop", "-", baseline, pixels);
+   g_baseline_ns = baseline;
+
+   bool ok = true;
+   for (kernels::Isa isa : {kernels::Isa::Scalar, kernels::Isa::SSE2, kernels::Isa::AVX2})
+   {
+      if (!kernels::SetIsa(isa))
+         continue;
+
+      const char* name = kernels::IsaName(isa);
+
+      std::memset(target.GetData(), 0, target.GetPitch() * g_height);
+      kernels::FillPattern(target, bounds, red, blue, TILE_W, TILE_H);
+      if (!same_pixels(reference, target))
+      {
+         std::fprintf(stderr, "error: %s checkerboard differs from the reference loop\n", name);
+         ok = false;
+      }
+
+      report("checkerboard pattern", name,
+             time_ns([&] { kernels::FillPattern(target, bounds, red, blue, TILE_W, TILE_H); }), pixels);
+      report("fill", name, time_ns([&] { kernels::FillRect(target, bounds, red); }), pixels);
+      report("fill rect 64x64", name, time_ns([&] { kernels::FillRect(target, box, blue); }), 64.0 * 64.0);
+      report("replicate row", name, time_ns([&] { kernels::ReplicateRow(target, 0, bounds); }), pixels);
+   }
+
+   std::printf("\n");
+   return ok;
+}
+
+template <typename Pixel>
+static void expand_loop(const Surface& src, const Surface& dst, const Pixel* lut)
+{
+   for (uint32_t y = 0; y < src.GetHeight(); ++y)
+   {
+      const uint8_t* in = src.GetRow(y);
+      Pixel* out = dst.GetRowAs<Pixel>(y);
+      for (uint32_t x = 0; x < src.GetWidth(); ++x)
+         out[x] = lut[in[x]];
+   }
+}
+
+static bool bench_expand(PixelFormat format)
+{
+   const double pixels = double(g_width) * g_height;
+
+   // Every index in use, in an order no stride predicts
+   Surface indexed(g_width, g_height, PixelFormat::Indexed8);
+   opus::gfx::Palette palette;
+   for (uint32_t i = 0; i < opus::gfx::Palette::MAX_COLORS; ++i)
+      palette.SetColor(uint8_t(i), opus::gfx::Color(i * 0x010307u + 0x203040u));
+   for (uint32_t y = 0; y < g_height; ++y)
+   {
+      for (uint32_t x = 0; x < g_width; ++x)
+         indexed.GetRow(y)[x] = uint8_t((x * 7 + y * 13) ^ (x >> 3));
+   }
+
+   Surface reference(g_width, g_height, format);
+   Surface target(g_width, g_height, format);
+
+   uint32_t lut32[opus::gfx::Palette::MAX_COLORS];
+   uint16_t lut16[opus::gfx::Palette::MAX_COLORS];
+   for (uint32_t i = 0; i < opus::gfx::Palette::MAX_COLORS; ++i)
+   {
+      lut32[i] = target.Pack(palette.GetColor(uint8_t(i)));
+      lut16[i] = uint16_t(lut32[i]);
+   }
+
+   std::printf("Indexed8 -> %s %ux%u\n", format_name(format), g_width, g_height);
+
+   g_baseline_ns = 0.0;
+   const double baseline = format == PixelFormat::XRGB8888
+      ? time_ns([&] { expand_loop(indexed, reference, lut32); })
+      : time_ns([&] { expand_loop(indexed, reference, lut16); });
+   report("expand loop", "-", baseline, pixels);
+   g_baseline_ns = baseline;
+
+   bool ok = true;
+   for (kernels::Isa isa : {kernels::Isa::Scalar, kernels::Isa::SSE2, kernels::Isa::AVX2})
+   {
+      if (!kernels::SetIsa(isa))
+         continue;
+
+      const char* name = kernels::IsaName(isa);
+
+      std::memset(target.GetData(), 0, target.GetPitch() * g_height);
+      kernels::Expand(indexed, target, palette);
+      if (!same_pixels(reference, target))
+      {
+         std::fprintf(stderr, "error: %s expansion differs from the reference loop\n", name);
+         ok = false;
+      }
+
+      report("expand", name, time_ns([&] { kernels::Expand(indexed, target, palette); }), pixels);
+
+      // Only the 16 rotated entries are reconverted each frame
+      opus::gfx::Palette cycling = palette;
+      report("cycle 16 + expand", name, time_ns([&]
+      {
+         cycling.Cycle(16, 31);
+         kernels::Expand(indexed, target, cycling);
+      }), pixels);
+   }
+
+   std::printf("\n");
+   return ok;
+}
+
+// Per pixel through Color and Surface::Pack, like code written before the traits
+static void convert_loop(const Surface& src, const Surface& dst)
+{
+   for (uint32_t y = 0; y < src.GetHeight(); ++y)
+   {
+      for (uint32_t x = 0; x < src.GetWidth(); ++x)
+      {
+         uint32_t xrgb = 0;
+         if (src.GetFormat() == PixelFormat::XRGB8888)
+            xrgb = src.GetRowAs<uint32_t>(y)[x];
+         else if (src.GetFormat() == PixelFormat::RGB565)
+            xrgb = opus::gfx::pixel::RGB565::ToXRGB(src.GetRowAs<uint16_t>(y)[x]);
+         else
+            xrgb = opus::gfx::pixel::XRGB1555::ToXRGB(src.GetRowAs<uint16_t>(y)[x]);
+
+         const uint32_t packed = dst.Pack(opus::gfx::Color(xrgb));
+         if (dst.GetFormat() == PixelFormat::XRGB8888)
+            dst.GetRowAs<uint32_t>(y)[x] = packed;
+         else
+            dst.GetRowAs<uint16_t>(y)[x] = uint16_t(packed);
+      }
+   }
+}
+
+static bool bench_convert(PixelFormat from, PixelFormat to)
+{
+   const double pixels = double(g_width) * g_height;
+
+   Surface src(g_width, g_height, from);
+   for (uint32_t y = 0; y < g_height; ++y)
+   {
+      for (uint32_t x = 0; x < g_width; ++x)
+      {
+         const uint32_t value = (x * 2654435761u) ^ (y * 40503u);
+         if (from == PixelFormat::XRGB8888)
+            src.GetRowAs<uint32_t>(y)[x] = value & 0x00FFFFFFu;
+         else
+            src.GetRowAs<uint16_t>(y)[x] = uint16_t(from == PixelFormat::XRGB1555 ? value & 0x7FFFu : value);
+      }
+   }
+
+   Surface reference(g_width, g_height, to);
+   Surface target(g_width, g_height, to);
+
+   std::printf("%s -> %s %ux%u\n", format_name(from), format_name(to), g_width, g_height);
+
+   g_baseline_ns = 0.0;
+   const double baseline = time_ns([&] { convert_loop(src, reference); });
+   report("per-pixel Color loop", "-", baseline, pixels);
+   g_baseline_ns = baseline;
+
+   kernels::Convert(src, target);
+   const bool ok = same_pixels(reference, target);
+   if (!ok)
+      std::fprintf(stderr, "error: %s -> %s conversion differs from the reference loop\n", format_name(from),
+                   format_name(to));
+
+   report("batch convert", OPUS_PIXEL_SSE2 ? "SSE2" : "Scalar",
+          time_ns([&] { kernels::Convert(src, target); }), pixels);
+
+   std::printf("\n");
+   return ok;
+}
+
+// A scene of SPRITE_COUNT sprites, some hanging off the edges
+static void draw_sprites(const Surface& target, const Surface& image, const opus::gfx::BlitOptions& options)
+{
+   for (uint32_t i = 0; i < SPRITE_COUNT; ++i)
+   {
+      const int32_t x = int32_t((i * 97u) % (g_width + SPRITE_SIZE)) - int32_t(SPRITE_SIZE / 2);
+      const int32_t y = int32_t((i * 61u) % (g_height + SPRITE_SIZE)) - int32_t(SPRITE_SIZE / 2);
+      kernels::Blit(target, x, y, image, image.GetBounds(), options);
+   }
+}
+
+static double sprite_pixels(const Surface& target)
+{
+   double pixels = 0.0;
+   for (uint32_t i = 0; i < SPRITE_COUNT; ++i)
+   {
+      const int32_t x = int32_t((i * 97u) % (g_width + SPRITE_SIZE)) - int32_t(SPRITE_SIZE / 2);
+      const int32_t y = int32_t((i * 61u) % (g_height + SPRITE_SIZE)) - int32_t(SPRITE_SIZE / 2);
+      pixels += double(Rect{x, y, int32_t(SPRITE_SIZE), int32_t(SPRITE_SIZE)}.Intersect(target.GetBounds()).Area());
+   }
+   return pixels;
+}
+
+static bool bench_sprites(PixelFormat format)
+{
+   using opus::gfx::BlendMode;
+   using opus::gfx::BlitOptions;
+
+   // A disc on a keyed background, plus an alpha version with a soft edge
+   Surface keyed(SPRITE_SIZE, SPRITE_SIZE, format);
+   Surface alpha(SPRITE_SIZE, SPRITE_SIZE, PixelFormat::XRGB8888);
+   const uint32_t key = keyed.Pack(opus::gfx::Color(0xFF00FF));
+   const uint32_t ink = keyed.Pack(opus::gfx::Color(0x40C080));
+   for (uint32_t y = 0; y < SPRITE_SIZE; ++y)
+   {
+      for (uint32_t x = 0; x < SPRITE_SIZE; ++x)
+      {
+         const int32_t dx = int32_t(x * 2) - int32_t(SPRITE_SIZE) + 1;
+         const int32_t dy = int32_t(y * 2) - int32_t(SPRITE_SIZE) + 1;
+         const int32_t d2 = dx * dx + dy * dy;
+         const int32_t r2 = int32_t(SPRITE_SIZE * SPRITE_SIZE);
+         const uint32_t value = d2 < r2 ? ink + (x ^ y) : key;
+         if (format == PixelFormat::XRGB8888)
+            keyed.GetRowAs<uint32_t>(y)[x] = value;
+         else
+            keyed.GetRowAs<uint16_t>(y)[x] = uint16_t(value);
+
+         const uint32_t a = d2 >= r2 ? 0u : uint32_t(std::min<int32_t>(255, (r2 - d2) / 4));
+         alpha.GetRowAs<uint32_t>(y)[x] = (a << 24) | 0x40C080u | (x << 2);
+      }
+   }
+
+   struct Mode
+   {
+      const char* name;
+      const Surface* image;
+      BlitOptions options;
+   };
+   const Mode modes[] = {
+      {"sprites opaque", &keyed, BlitOptions{BlendMode::Opaque, 0, false, false}},
+      {"sprites opaque flip", &keyed, BlitOptions{BlendMode::Opaque, 0, true, true}},
+      {"sprites colour key", &keyed, BlitOptions{BlendMode::ColorKey, key, false, false}},
+      {"sprites key flip", &keyed, BlitOptions{BlendMode::ColorKey, key, true, false}},
+      {"sprites alpha", &alpha, BlitOptions{BlendMode::Alpha, 0, false, false}},
+      {"sprites alpha flip", &alpha, BlitOptions{BlendMode::Alpha, 0, true, true}},
+   };
+
+   Surface reference(g_width, g_height, format);
+   Surface target(g_width, g_height, format);
+   const double pixels = sprite_pixels(target);
+
+   std::printf("%u sprites %ux%u -> %s %ux%u\n", SPRITE_COUNT, SPRITE_SIZE, SPRITE_SIZE, format_name(format),
+               g_width, g_height);
+   g_baseline_ns = 0.0;
+
+   bool ok = true;
+   for (kernels::Isa isa : {kernels::Isa::Scalar, kernels::Isa::SSE2, kernels::Isa::AVX2})
+   {
+      if (!kernels::SetIsa(isa))
+         continue;
+
+      const char* name = kernels::IsaName(isa);
+      for (const Mode& mode : modes)
+      {
+         // Every ISA must draw exactly what the scalar kernels draw
+         const uint32_t background = target.Pack(opus::gfx::Color(0x102030));
+         kernels::SetIsa(kernels::Isa::Scalar);
+         kernels::FillRect(reference, reference.GetBounds(), background);
+         draw_sprites(reference, *mode.image, mode.options);
+         kernels::SetIsa(isa);
+
+         kernels::FillRect(target, target.GetBounds(), background);
+         draw_sprites(target, *mode.image, mode.options);
+         if (!same_pixels(reference, target))
+         {
+            std::fprintf(stderr, "error: %s %s differs from the scalar blit\n", name, mode.name);
+            ok = false;
+         }
+
+         report(mode.name, name, time_ns([&] { draw_sprites(target, *mode.image, mode.options); }), pixels);
+      }
+   }
+
+   std::printf("\n");
+   return ok;
+}
+
+// What the layer replaces: one opaque blit per visible tile
+static void tile_blits(const Surface& target, const Surface& tileset, const opus::gfx::TileMapLayer& layer)
+{
+   const uint32_t per_row = tileset.GetWidth() / MAP_TILE;
+   const int32_t tile = int32_t(MAP_TILE);
+   const int32_t scroll_x = layer.GetScrollX();
+   const int32_t scroll_y = layer.GetScrollY();
+
+   for (int32_t ty = scroll_y / tile; ty * tile < scroll_y + int32_t(g_height); ++ty)
+   {
+      for (int32_t tx = scroll_x / tile; tx * tile < scroll_x + int32_t(g_width); ++tx)
+      {
+         const uint16_t index = layer.GetTile(uint32_t(tx) % MAP_SIZE, uint32_t(ty) % MAP_SIZE);
+         const Rect frame{int32_t(index % per_row) * tile, int32_t(index / per_row) * tile, tile, tile};
+         kernels::Blit(target, tx * tile - scroll_x, ty * tile - scroll_y, tileset, frame, opus::gfx::BlitOptions{});
+      }
+   }
+}
+
+static bool bench_tilemap(PixelFormat format)
+{
+   const double pixels = double(g_width) * g_height;
+
+   // 256 distinct XRGB8888 tiles, converted to the target format by the cache
+   Surface tileset(MAP_TILE * 16, MAP_TILE * 16, PixelFormat::XRGB8888);
+   for (uint32_t y = 0; y < tileset.GetHeight(); ++y)
+   {
+      for (uint32_t x = 0; x < tileset.GetWidth(); ++x)
+         tileset.GetRowAs<uint32_t>(y)[x] = (x * 0x0301u) ^ (y * 0x050700u);
+   }
+
+   opus::gfx::TileMapLayer layer;
+   layer.SetTileset(tileset, MAP_TILE, MAP_TILE);
+   layer.SetMapSize(MAP_SIZE, MAP_SIZE);
+   layer.SetWrapping(true);
+   for (uint32_t y = 0; y < MAP_SIZE; ++y)
+   {
+      for (uint32_t x = 0; x < MAP_SIZE; ++x)
+         layer.SetTile(x, y, uint16_t((x * 7 + y * 11) & 0xFF));
+   }
+
+   Surface converted(tileset.GetWidth(), tileset.GetHeight(), format);
+   kernels::Convert(tileset, converted);
+
+   Surface reference(g_width, g_height, format);
+   Surface target(g_width, g_height, format);
+   Surface copy(g_width, g_height, format);
+   const size_t row = size_t(g_width) * opus::gfx::BytesPerPixel(format);
+
+   std::printf("tile map %ux%u of %ux%u -> %s %ux%u\n", MAP_SIZE, MAP_SIZE, MAP_TILE, MAP_TILE, format_name(format),
+               g_width, g_height);
+
+   g_baseline_ns = 0.0;
+   report("frame copy", "-", time_ns([&]
+   {
+      for (uint32_t y = 0; y < g_height; ++y)
+         std::memcpy(copy.GetRow(y), reference.GetRow(y), row);
+   }), pixels);
+
+   const double baseline = time_ns([&] { tile_blits(reference, converted, layer); });
+   report("blit per tile", "-", baseline, pixels);
+   g_baseline_ns = baseline;
+
+   // Mid-tile scroll, so both paths clip tiles on every edge
+   layer.SetScroll(37, 21);
+   tile_blits(reference, converted, layer);
+   layer.Draw(target);
+   const bool ok = same_pixels(reference, target);
+   if (!ok)
+      std::fprintf(stderr, "error: %s tile map differs from per-tile blits\n", format_name(format));
+
+   int32_t scroll = 0;
+   report("tile map scroll", "-", time_ns([&]
+   {
+      ++scroll;
+      layer.SetScroll(scroll * 3, scroll * 2);
+      layer.Draw(target);
+   }), pixels);
+
+   std::printf("\n");
+   return ok;
+}
+
+// A full redraw of a sprite-heavy scene, on the update thread and then on
+// pools of growing size
+static bool bench_banded(uint32_t width, uint32_t height)
+{
+   using opus::gfx::BlendMode;
+
+   Surface image(SPRITE_SIZE, SPRITE_SIZE, PixelFormat::XRGB8888);
+   for (uint32_t y = 0; y < SPRITE_SIZE; ++y)
+   {
+      for (uint32_t x = 0; x < SPRITE_SIZE; ++x)
+         image.GetRowAs<uint32_t>(y)[x] = (((x ^ y) * 8u) << 24) | (x * 0x0800u) | (y * 0x080000u);
+   }
+
+   Surface reference(width, height, PixelFormat::XRGB8888);
+   Surface target(width, height, PixelFormat::XRGB8888);
+
+   opus::gfx::DrawableTask scene;
+   scene.SetTarget(target);
+   scene.SetClearColor(opus::gfx::Color(0x102030));
+   scene.Enable();
+
+   // Every third sprite is alpha blended, the rest colour keyed
+   std::vector<std::unique_ptr<opus::gfx::Sprite>> sprites;
+   for (uint32_t i = 0; i < SCENE_SPRITES; ++i)
+   {
+      sprites.push_back(std::make_unique<opus::gfx::Sprite>(image));
+      opus::gfx::Sprite& sprite = *sprites.back();
+      sprite.SetBlendMode(i % 3 ? BlendMode::ColorKey : BlendMode::Alpha);
+      sprite.SetColorKey(opus::gfx::Color(image.GetRowAs<uint32_t>(0)[0]));
+      sprite.SetPosition(int32_t((i * 7919u) % (width + SPRITE_SIZE)) - int32_t(SPRITE_SIZE),
+                         int32_t((i * 104729u) % (height + SPRITE_SIZE)) - int32_t(SPRITE_SIZE));
+      scene.AddDrawable(sprite);
+   }
+
+   std::printf("%u sprites, banded redraw %ux%u\n", SCENE_SPRITES, width, height);
+
+   const double pixels = double(width) * height;
+   uint64_t frame = 0;
+   const auto redraw = [&]
+   {
+      scene.Invalidate();
+      scene.Update(frame++);
+   };
+
+   g_baseline_ns = 0.0;
+   redraw();
+   for (uint32_t y = 0; y < height; ++y)
+      std::memcpy(reference.GetRow(y), target.GetRow(y), size_t(width) * 4);
+
+   const double serial = time_ns(redraw);
+   std::printf("  %-22s %-7s %10.1f ns  %9.1f MPix/s\n", "1 thread", "-", serial, pixels * 1e3 / serial);
+
+   bool ok = true;
+   const auto recorded = [&](const char* name)
+   {
+      scene.SetRecording(true);
+      redraw();
+      if (!same_pixels(reference, target))
+      {
+         std::fprintf(stderr, "error: %s recorded redraw differs from immediate drawing\n", name);
+         ok = false;
+      }
+
+      const double ns = time_ns(redraw);
+      std::printf("  %-22s %-7s %10.1f ns  %9.1f MPix/s  x%.2f  %zu commands\n", name, "list", ns, pixels * 1e3 / ns,
+                  serial / ns, scene.GetDisplayList().GetCommands().size());
+      scene.SetRecording(false);
+   };
+   recorded("1 thread");
+
+   // 2, 4, 8, ... threads, then every hardware thread; at least one pool
+   std::vector<uint32_t> counts;
+   const uint32_t hardware = std::max(2u, std::thread::hardware_concurrency());
+   for (uint32_t threads = 2; threads < hardware; threads *= 2)
+      counts.push_back(threads);
+   counts.push_back(hardware);
+
+   for (uint32_t threads : counts)
+   {
+      opus::jobs::JobPool pool(threads - 1);
+      scene.SetJobPool(&pool);
+
+      redraw();
+      if (!same_pixels(reference, target))
+      {
+         std::fprintf(stderr, "error: %u-thread banded redraw differs from a single thread\n", threads);
+         ok = false;
+      }
+
+      char name[32];
+      std::snprintf(name, sizeof(name), "%u threads, %u bands", threads, scene.GetBandCount());
+      const double ns = time_ns(redraw);
+      std::printf("  %-22s %-7s %10.1f ns  %9.1f MPix/s  x%.2f\n", name, "-", ns, pixels * 1e3 / ns, serial / ns);
+      recorded(name);
+
+      scene.SetJobPool(nullptr);
+   }
+
+   std::printf("\n");
+   return ok;
+}
+
+// Sprites that change depth every frame: the task re-sorts its draw order
+// on each pass instead of having them removed and added again
+static bool bench_layers(uint32_t width, uint32_t height)
+{
+   using opus::gfx::BlendMode;
+
+   Surface image(SPRITE_SIZE, SPRITE_SIZE, PixelFormat::XRGB8888);
+   for (uint32_t y = 0; y < SPRITE_SIZE; ++y)
+   {
+      for (uint32_t x = 0; x < SPRITE_SIZE; ++x)
+         image.GetRowAs<uint32_t>(y)[x] = (x * 0x0800u) | (y * 0x080000u) | (x ^ y);
+   }
+
+   Surface reference(width, height, PixelFormat::XRGB8888);
+   Surface target(width, height, PixelFormat::XRGB8888);
+
+   // The reference adds the sprites back to front; the scene adds them
+   // front to back and reverses them with layers
+   opus::gfx::DrawableTask ordered;
+   opus::gfx::DrawableTask scene;
+   ordered.SetTarget(reference);
+   scene.SetTarget(target);
+   ordered.SetClearColor(opus::gfx::Color(0x102030));
+   scene.SetClearColor(opus::gfx::Color(0x102030));
+   ordered.Enable();
+   scene.Enable();
+
+   std::vector<std::unique_ptr<opus::gfx::Sprite>> sprites;
+   std::vector<std::unique_ptr<opus::gfx::Sprite>> copies;
+   for (uint32_t i = 0; i < SCENE_SPRITES; ++i)
+   {
+      for (auto* list : {&sprites, &copies})
+      {
+         list->push_back(std::make_unique<opus::gfx::Sprite>(image));
+         opus::gfx::Sprite& sprite = *list->back();
+         sprite.SetBlendMode(BlendMode::Opaque);
+         sprite.SetPosition(int32_t((i * 7919u) % (width + SPRITE_SIZE)) - int32_t(SPRITE_SIZE),
+                            int32_t((i * 104729u) % (height + SPRITE_SIZE)) - int32_t(SPRITE_SIZE));
+      }
+      sprites.back()->SetLayer(uint16_t(SCENE_SPRITES - i));
+      scene.AddDrawable(*sprites.back());
+   }
+   for (uint32_t i = SCENE_SPRITES; i-- > 0;)
+      ordered.AddDrawable(*copies[i]);
+
+   ordered.Update(0);
+   scene.Update(0);
+   bool ok = same_pixels(reference, target);
+   if (!ok)
+      std::fprintf(stderr, "error: layered drawing differs from insertion order\n");
+
+   std::printf("%u sprites, depth changes %ux%u\n", SCENE_SPRITES, width, height);
+
+   const double pixels = double(width) * height;
+   uint64_t frame = 1;
+   g_baseline_ns = 0.0;
+   report("fixed layers", "-", time_ns([&]
+   {
+      scene.Invalidate();
+      scene.Update(frame++);
+   }), pixels);
+
+   // Every sprite moves to a new layer each frame
+   report("all layers change", "-", time_ns([&]
+   {
+      for (uint32_t i = 0; i < SCENE_SPRITES; ++i)
+         sprites[i]->SetLayer(uint16_t((i * 40503u + frame * 2654435761u) >> 16));
+      scene.Invalidate();
+      scene.Update(frame++);
+   }), pixels);
+
+   std::printf("\n");
+   return ok;
+}
+
+// A fixed on-screen crowd among a growing number of off-screen drawables;
+// with culling, the frame cost should not follow the registered count
+static void bench_culling(uint32_t width, uint32_t height)
+{
+   using opus::gfx::BlendMode;
+
+   Surface image(SPRITE_SIZE, SPRITE_SIZE, PixelFormat::XRGB8888);
+   for (uint32_t y = 0; y < SPRITE_SIZE; ++y)
+   {
+      for (uint32_t x = 0; x < SPRITE_SIZE; ++x)
+         image.GetRowAs<uint32_t>(y)[x] = (x * 0x0800u) | (y * 0x080000u);
+   }
+
+   Surface target(width, height, PixelFormat::XRGB8888);
+
+   std::printf("%u on-screen sprites among off-screen ones %ux%u\n", SPRITE_COUNT, width, height);
+
+   const double pixels = double(width) * height;
+   for (uint32_t registered : {SPRITE_COUNT, 10000u, 100000u})
+   {
+      opus::gfx::DrawableTask scene;
+      scene.SetTarget(target);
+      scene.SetClearColor(opus::gfx::Color(0x102030));
+      scene.Enable();
+
+      // The rest are spread over a world 64 screens wide, left of the target
+      std::vector<std::unique_ptr<opus::gfx::Sprite>> sprites;
+      for (uint32_t i = 0; i < registered; ++i)
+      {
+         sprites.push_back(std::make_unique<opus::gfx::Sprite>(image));
+         opus::gfx::Sprite& sprite = *sprites.back();
+         sprite.SetBlendMode(BlendMode::Opaque);
+         if (i < SPRITE_COUNT)
+            sprite.SetPosition(int32_t((i * 7919u) % width), int32_t((i * 104729u) % height));
+         else
+            sprite.SetPosition(-int32_t(SPRITE_SIZE) - int32_t((i * 7919u) % (width * 64)),
+                               int32_t((i * 104729u) % (height * 8)) - int32_t(height * 4));
+         scene.AddDrawable(sprite);
+      }
+
+      uint64_t frame = 0;
+      scene.Update(frame++);
+
+      char name[32];
+      g_baseline_ns = 0.0;
+      std::snprintf(name, sizeof(name), "%u full redraw", registered);
+      report(name, "-", time_ns([&]
+      {
+         scene.Invalidate();
+         scene.Update(frame++);
+      }), pixels);
+
+      // One on-screen and one off-screen sprite move each frame
+      std::snprintf(name, sizeof(name), "%u two moves", registered);
+      report(name, "-", time_ns([&]
+      {
+         const uint32_t i = uint32_t(frame % SPRITE_COUNT);
+         sprites[i]->SetPosition(int32_t((frame * 7u) % width), sprites[i]->GetY());
+         sprites[registered - 1 - i]->SetPosition(sprites[registered - 1 - i]->GetX() - 1, 0);
+         scene.Update(frame++);
+      }), pixels);
+   }
+
+   std::printf("\n");
+}
+
+// Per-frame scratch and object churn, heap against the arena and a pool.
+// The opus allocators must not go back to the heap once they are warm.
+static bool bench_memory()
+{
+   static constexpr size_t SCRATCH_COUNT = 4096;
+   static constexpr size_t CHURN_COUNT   = 1000;
+
+   std::printf("memory, %zu-entry scratch and %zu sprites per frame\n", SCRATCH_COUNT, CHURN_COUNT);
+
+   // Three scratch arrays, as a pass that bins or sorts would use
+   const auto use = [](uint32_t* a, uint32_t* b, uint32_t* c)
+   {
+      for (size_t i = 0; i < SCRATCH_COUNT; ++i)
+      {
+         a[i] = uint32_t(i);
+         b[i] = a[i] ^ 0x5555u;
+         c[i] = b[i] + a[SCRATCH_COUNT - 1 - i];
+      }
+      volatile uint32_t sink = c[SCRATCH_COUNT / 2];
+      (void)sink;
+   };
+
+   // Not pixel work: time only, and the heap version as the baseline
+   const auto line = [](const char* name, double ns, double baseline)
+   {
+      std::printf("  %-22s %-7s %10.1f ns", name, "-", ns);
+      if (baseline > 0.0)
+         std::printf("  x%.1f", baseline / ns);
+      std::printf("\n");
+   };
+
+   const double heapScratch = time_ns([&]
+   {
+      std::vector<uint32_t> a(SCRATCH_COUNT);
+      std::vector<uint32_t> b(SCRATCH_COUNT);
+      std::vector<uint32_t> c(SCRATCH_COUNT);
+      use(a.data(), b.data(), c.data());
+   });
+   line("scratch, heap", heapScratch, 0.0);
+
+   opus::memory::FrameArena arena;
+   const auto frame = [&]
+   {
+      arena.Reset();
+      use(arena.AllocateArray<uint32_t>(SCRATCH_COUNT), arena.AllocateArray<uint32_t>(SCRATCH_COUNT),
+          arena.AllocateArray<uint32_t>(SCRATCH_COUNT));
+   };
+   frame();
+   opus::memory::Stats before = opus::memory::GetStats();
+   line("scratch, arena", time_ns(frame), heapScratch);
+   bool ok = opus::memory::GetStats().allocations == before.allocations;
+
+   Surface image(SPRITE_SIZE, SPRITE_SIZE, PixelFormat::XRGB8888);
+   std::vector<std::unique_ptr<opus::gfx::Sprite>> owned(CHURN_COUNT);
+   const double heapSprites = time_ns([&]
+   {
+      for (auto& sprite : owned)
+         sprite = std::make_unique<opus::gfx::Sprite>(image);
+      for (auto& sprite : owned)
+         sprite.reset();
+   });
+   line("sprites, heap", heapSprites, 0.0);
+
+   opus::memory::ObjectPool<opus::gfx::Sprite> pool;
+   pool.Reserve(CHURN_COUNT);
+   std::vector<opus::gfx::Sprite*> pooled(CHURN_COUNT);
+   before = opus::memory::GetStats();
+   line("sprites, pool", time_ns([&]
+   {
+      for (auto& sprite : pooled)
+         sprite = pool.Create(image);
+      for (auto& sprite : pooled)
+         pool.Destroy(sprite);
+   }), heapSprites);
+   ok &= opus::memory::GetStats().allocations == before.allocations;
+
+   if (!ok)
+      std::fprintf(stderr, "error: a warm arena or pool allocated from the heap\n");
+
+   std::printf("\n");
+   return ok;
+}
+
+// Whole frames with children on a pool: each tick they take scratch from
+// their worker's arena, disable and enable a sibling, move sprites, and one
+// removes and re-adds a spare task, so every command queue is in use. Once
+// warm, neither Parallel nor Graph mode may allocate.
+static bool bench_frame_heap()
+{
+   static constexpr uint32_t TASK_COUNT = 64;
+   static constexpr uint32_t SPRITES    = 200;
+   static constexpr uint32_t WORKERS    = 3;
+   static constexpr int32_t PATH       = 256; // Sprites move along this many pixels
+
+   std::printf("frame heap traffic, %u tasks and %u sprites on %u threads%s\n", TASK_COUNT, SPRITES,
+               WORKERS + 1, OPUS_BENCH_COUNT_HEAP ? "" : " (opus blocks only)");
+
+   struct Spare : opus::tasks::Task
+   {
+      Spare() : Task(1, 0, true, false) {}
+      void OnUpdate(uint64_t) override {}
+   };
+
+   struct Child : opus::tasks::Task
+   {
+      explicit Child(uint32_t modulo) : Task(modulo, 0, true, false) {}
+
+      void OnUpdate(uint64_t count) override
+      {
+         opus::memory::FrameArena& arena = opus::memory::GetFrameArena();
+         const opus::memory::ArenaScope scratch(arena);
+         uint32_t* values = arena.AllocateArray<uint32_t>(256);
+         for (uint32_t i = 0; i < 256; ++i)
+            values[i] = uint32_t(count) * i;
+         sum += values[count % 256];
+
+         if (sibling)
+            (count & 1) ? sibling->Disable() : sibling->Enable();
+         if (sprite)
+            sprite->SetPosition(int32_t(count % PATH), sprite->GetY());
+         if (container && spare)
+            (count & 1) ? container->RemoveTask(*spare) : container->AddTask(*spare);
+      }
+
+      uint64_t sum = 0;
+      Task* sibling = nullptr;
+      opus::gfx::Sprite* sprite = nullptr;
+      opus::tasks::TaskContainer* container = nullptr;
+      Task* spare = nullptr;
+   };
+
+   Surface image(SPRITE_SIZE, SPRITE_SIZE, PixelFormat::XRGB8888);
+   image.Fill(opus::gfx::Color(0x808080));
+   Surface target(g_width, g_height, PixelFormat::XRGB8888);
+
+   opus::jobs::JobPool pool(WORKERS);
+   opus::gfx::DrawableTask scene;
+   scene.SetTarget(target);
+   scene.SetJobPool(&pool);
+   scene.Enable();
+
+   std::vector<std::unique_ptr<opus::gfx::Sprite>> sprites;
+   for (uint32_t i = 0; i < SPRITES; ++i)
+   {
+      sprites.push_back(std::make_unique<opus::gfx::Sprite>(image));
+      sprites.back()->SetPosition(int32_t((i * 7919u) % g_width), int32_t((i * 104729u) % g_height));
+      scene.AddDrawable(*sprites.back());
+   }
+
+   bool ok = true;
+   for (opus::tasks::ExecutionMode mode : {opus::tasks::ExecutionMode::Parallel, opus::tasks::ExecutionMode::Graph})
+   {
+      const bool graph = mode == opus::tasks::ExecutionMode::Graph;
+
+      Spare spare;
+      std::vector<std::unique_ptr<Child>> children;
+      opus::tasks::TaskContainer tasks;
+      tasks.SetJobPool(&pool);
+      for (uint32_t i = 0; i < TASK_COUNT; ++i)
+      {
+         children.push_back(std::make_unique<Child>(1 + i % 4));
+         Child& child = *children.back();
+         child.SetIndependent(true);
+         if (i % 8 == 1)
+            child.sibling = children[i - 1].get();
+         if (i < 8)
+            child.sprite = sprites[i].get();
+         if (graph && i >= 16)
+            child.DependsOn(*children[i - 16]);
+         tasks.AddTask(child);
+      }
+      children.front()->container = &tasks;
+      children.front()->spare = &spare;
+      tasks.SetExecutionMode(mode);
+
+      uint64_t frame = 0;
+      const std::function<void()> tick = [&]
+      {
+         opus::memory::GetFrameArena().Reset();
+         pool.NextFrame();
+         tasks.Update(frame);
+         scene.Update(frame);
+         ++frame;
+      };
+
+      // Every cell along the path has been filed into once
+      for (int32_t i = 0; i < PATH * 2; ++i)
+         tick();
+
+      const uint64_t before = heap_allocations();
+      const double ns = time_ns(tick);
+      const uint64_t allocations = heap_allocations() - before;
+      const unsigned frames = g_iterations / 10 + 1 + g_iterations;
+      std::printf("  %-22s %-7s %10.1f ns  %6.2f allocs/frame\n", graph ? "graph" : "parallel", "-", ns,
+                  double(allocations) / frames);
+      ok &= allocations == 0;
+   }
+
+   if (!ok)
+      std::fprintf(stderr, "error: a warm frame allocated from the heap\n");
+
+   std::printf("\n");
+   return ok;
+}
+
+// One stage of the dispatch pipeline, gated at compile time
+template <uint32_t Modulo>
+struct StaticStage : opus::tasks::StaticTask<StaticStage<Modulo>, Modulo>
+{
+   void OnUpdate(uint64_t count) { total += count; }
+
+   uint64_t total = 0;
+};
+
+using StaticPipeline = opus::tasks::StaticTaskContainer<StaticStage<1>, StaticStage<2>, StaticStage<3>, StaticStage<4>>;
+
+// The same fixed pipelines as virtual Tasks in one TaskContainer and as
+// StaticTaskContainers expanded at compile time; both must do the same work
+static bool bench_task_dispatch()
+{
+   static constexpr uint32_t PIPELINES = 250;
+
+   std::printf("task dispatch, %u pipelines of 4 stages\n", PIPELINES);
+
+   struct Stage : opus::tasks::Task
+   {
+      explicit Stage(uint32_t modulo) : Task(modulo, 0, true, false) {}
+
+      void OnUpdate(uint64_t count) override { total += count; }
+
+      uint64_t total = 0;
+   };
+
+   const auto line = [](const char* name, double ns, double baseline)
+   {
+      std::printf("  %-22s %-7s %10.1f ns", name, "-", ns);
+      if (baseline > 0.0)
+         std::printf("  x%.1f", baseline / ns);
+      std::printf("\n");
+   };
+
+   std::vector<std::unique_ptr<Stage>> stages;
+   opus::tasks::TaskContainer virtualTasks;
+   for (uint32_t i = 0; i < PIPELINES; ++i)
+   {
+      for (uint32_t modulo = 1; modulo <= 4; ++modulo)
+      {
+         stages.push_back(std::make_unique<Stage>(modulo));
+         virtualTasks.AddTask(*stages.back());
+      }
+   }
+
+   std::vector<StaticPipeline> pipelines(PIPELINES);
+
+   uint64_t virtualFrame = 0;
+   const double virtualNs = time_ns([&] { virtualTasks.Update(virtualFrame++); });
+   line("virtual, container", virtualNs, 0.0);
+
+   uint64_t staticFrame = 0;
+   line("static, pipelines", time_ns([&]
+   {
+      for (StaticPipeline& pipeline : pipelines)
+         pipeline.Update(staticFrame);
+      ++staticFrame;
+   }), virtualNs);
+
+   uint64_t virtualTotal = 0;
+   for (const auto& stage : stages)
+      virtualTotal += stage->total;
+
+   uint64_t staticTotal = 0;
+   for (StaticPipeline& pipeline : pipelines)
+   {
+      staticTotal += pipeline.Get<0>().total + pipeline.Get<1>().total + pipeline.Get<2>().total +
+                     pipeline.Get<3>().total;
+   }
+
+   const bool ok = virtualFrame == staticFrame && virtualTotal == staticTotal;
+   if (!ok)
+      std::fprintf(stderr, "error: static and virtual pipelines did different work\n");
+
+   std::printf("\n");
+   return ok;
+}
+
+// A three-step behaviour as a routine and as the switch it replaces, then
+// routine start-up, which must not reach the heap once the frame pool is warm
+static bool bench_coroutines()
+{
+   static constexpr uint32_t TASK_COUNT = 1000;
+
+   std::printf("coroutines, %u tasks\n", TASK_COUNT);
+
+   struct Machine : opus::tasks::Task
+   {
+      Machine() : Task(1, 0, true, false) {}
+
+      void OnUpdate(uint64_t count) override
+      {
+         switch (state)
+         {
+         case 0: sum += count; state = 1; break;
+         case 1: sum ^= count; state = 2; break;
+         default: sum -= 1; state = 0; break;
+         }
+      }
+
+      uint32_t state = 0;
+      uint64_t sum = 0;
+   };
+
+   struct Stepper : opus::tasks::CoroutineTask
+   {
+      opus::tasks::Routine Run() override
+      {
+         for (;;)
+         {
+            sum += CurrentCount();
+            co_await opus::tasks::NextTick{};
+            sum ^= CurrentCount();
+            co_await opus::tasks::NextTick{};
+            sum -= 1;
+            co_await opus::tasks::NextTick{};
+         }
+      }
+
+      uint64_t sum = 0;
+   };
+
+   // Waits on a flag, as a routine would on a loader or a pool job
+   struct Waiter : opus::tasks::CoroutineTask
+   {
+      opus::tasks::Routine Run() override
+      {
+         co_await opus::tasks::WaitFor(*ready);
+      }
+
+      const std::atomic<bool>* ready = nullptr;
+   };
+
+   const auto line = [](const char* name, double ns, double baseline)
+   {
+      std::printf("  %-22s %-7s %10.1f ns", name, "-", ns);
+      if (baseline > 0.0)
+         std::printf("  x%.1f", baseline / ns);
+      std::printf("\n");
+   };
+
+   std::vector<Machine> machines(TASK_COUNT);
+   std::vector<Stepper> steppers(TASK_COUNT);
+   opus::tasks::TaskContainer machineTasks;
+   opus::tasks::TaskContainer stepperTasks;
+   for (uint32_t i = 0; i < TASK_COUNT; ++i)
+   {
+      machineTasks.AddTask(machines[i]);
+      stepperTasks.AddTask(steppers[i]);
+   }
+
+   uint64_t frame = 0;
+   machineTasks.Update(frame);
+   stepperTasks.Update(frame++);
+
+   const double machineNs = time_ns([&] { machineTasks.Update(frame++); });
+   line("tick, state machine", machineNs, 0.0);
+   line("tick, routine", time_ns([&] { stepperTasks.Update(frame++); }), machineNs);
+
+   bool ok = true;
+   for (uint32_t i = 0; i < TASK_COUNT; ++i)
+      ok &= steppers[i].sum != 0;
+
+   std::atomic<bool> ready{false};
+   std::vector<Waiter> waiters(TASK_COUNT);
+   const auto start = [&]
+   {
+      ready.store(false, std::memory_order_relaxed);
+      for (Waiter& waiter : waiters)
+      {
+         waiter.ready = &ready;
+         waiter.Restart();
+         waiter.Update(frame);
+      }
+      ready.store(true, std::memory_order_release);
+      for (Waiter& waiter : waiters)
+         waiter.Update(frame);
+      ++frame;
+   };
+   start();
+   const opus::memory::Stats before = opus::memory::GetStats();
+   line("start and finish", time_ns(start), 0.0);
+   ok &= opus::memory::GetStats().allocations == before.allocations;
+   for (const Waiter& waiter : waiters)
+      ok &= waiter.IsFinished();
+
+   if (!ok)
+      std::fprintf(stderr, "error: routines did not run, or a warm frame pool allocated from the heap\n");
+
+   std::printf("\n");
+   return ok;
+}
+
+static void usage(const char* argv0)
+{
+   std::fprintf(stderr, "usage: %s [--size WxH] [--iterations N]\n", argv0);
+}
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+int main(int argc, char** argv)
+{
+   for (int i = 1; i < argc; ++i)
+   {
+      if (!std::strcmp(argv[i], "--size") && i + 1 < argc)
+      {
+         unsigned w = 0;
+         unsigned h = 0;
+         if (std::sscanf(argv[++i], "%ux%u", &w, &h) != 2 || w == 0 || h == 0)
+         {
+            usage(argv[0]);
+            return 1;
+         }
+         g_width = w;
+         g_height = h;
+      }
+      else if (!std::strcmp(argv[i], "--iterations") && i + 1 < argc)
+         g_iterations = unsigned(std::strtoul(argv[++i], nullptr, 10));
+      else
+      {
+         usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (g_iterations == 0)
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   const kernels::Isa best = kernels::GetIsa();
+   std::printf("dispatch    %s\n\n", kernels::IsaName(best));
+
+   bool ok = bench_format(PixelFormat::RGB565);
+   ok &= bench_format(PixelFormat::XRGB8888);
+   ok &= bench_format(PixelFormat::Indexed8);
+   ok &= bench_expand(PixelFormat::RGB565);
+   ok &= bench_expand(PixelFormat::XRGB8888);
+   ok &= bench_convert(PixelFormat::XRGB8888, PixelFormat::RGB565);
+   ok &= bench_convert(PixelFormat::RGB565, PixelFormat::XRGB8888);
+   ok &= bench_convert(PixelFormat::XRGB8888, PixelFormat::XRGB1555);
+   ok &= bench_convert(PixelFormat::XRGB1555, PixelFormat::XRGB8888);
+   ok &= bench_convert(PixelFormat::RGB565, PixelFormat::XRGB1555);
+   ok &= bench_convert(PixelFormat::XRGB1555, PixelFormat::RGB565);
+   ok &= bench_sprites(PixelFormat::RGB565);
+   ok &= bench_sprites(PixelFormat::XRGB8888);
+   ok &= bench_tilemap(PixelFormat::RGB565);
+   ok &= bench_tilemap(PixelFormat::XRGB8888);
+   ok &= bench_banded(320, 240);
+   ok &= bench_banded(640, 480);
+   ok &= bench_layers(320, 240);
+   bench_culling(320, 240);
+   ok &= bench_memory();
+   ok &= bench_frame_heap();
+   ok &= bench_task_dispatch();
+   ok &= bench_coroutines();
+
+   kernels::SetIsa(best);
+   return ok ? 0 : 1;
+}
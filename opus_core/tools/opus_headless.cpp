@@ -0,0 +1,413 @@
+// opus_headless.cpp - headless libretro frontend for benchmarking the Opus core
+//
+// Loads a core shared object through the retro_* entry points, drives
+// retro_run for N frames without a window or audio device, and reports
+// per-frame latency percentiles, throughput, peak RSS and heap allocations.
+//
+//   opus_headless <core.so> [--frames N] [--warmup N] [--no-dupe]
+//                 [--no-sw-framebuffer] [--dump frame.ppm]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <dlfcn.h>
+#include <sys/resource.h>
+
+extern "C" {
+#include <libretro.h>
+}
+
+// ------------------------------------------------------------
+// Heap accounting
+// ------------------------------------------------------------
+// Replacing the global operator new here also covers the core: its
+// references bind to the executable's definitions when it is loaded.
+static std::atomic<uint64_t> g_heap_allocations{0};
+
+void* operator new(size_t size)
+{
+   g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+   if (void* block = std::malloc(size ? size : 1))
+      return block;
+   throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+   g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+   const size_t align = std::max(size_t(alignment), sizeof(void*));
+   if (void* block = std::aligned_alloc(align, (size + align - 1) / align * align))
+      return block;
+   throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete(void* block, size_t) noexcept { std::free(block); }
+void operator delete(void* block, std::align_val_t) noexcept { std::free(block); }
+void operator delete(void* block, size_t, std::align_val_t) noexcept { std::free(block); }
+void operator delete[](void* block) noexcept { std::free(block); }
+void operator delete[](void* block, size_t) noexcept { std::free(block); }
+void operator delete[](void* block, std::align_val_t) noexcept { std::free(block); }
+void operator delete[](void* block, size_t, std::align_val_t) noexcept { std::free(block); }
+
+// ------------------------------------------------------------
+// Core entry points
+// ------------------------------------------------------------
+struct Core
+{
+   void* handle = nullptr;
+
+   void (*set_environment)(retro_environment_t) = nullptr;
+   void (*set_video_refresh)(retro_video_refresh_t) = nullptr;
+   void (*set_audio_sample)(retro_audio_sample_t) = nullptr;
+   void (*set_audio_sample_batch)(retro_audio_sample_batch_t) = nullptr;
+   void (*set_input_poll)(retro_input_poll_t) = nullptr;
+   void (*set_input_state)(retro_input_state_t) = nullptr;
+   void (*init)(void) = nullptr;
+   void (*deinit)(void) = nullptr;
+   unsigned (*api_version)(void) = nullptr;
+   void (*get_system_info)(retro_system_info*) = nullptr;
+   void (*get_system_av_info)(retro_system_av_info*) = nullptr;
+   bool (*load_game)(const retro_game_info*) = nullptr;
+   void (*unload_game)(void) = nullptr;
+   void (*run)(void) = nullptr;
+};
+
+template <typename Fn>
+static bool load_symbol(void* handle, const char* name, Fn& fn)
+{
+   fn = reinterpret_cast<Fn>(dlsym(handle, name));
+   if (!fn)
+      std::fprintf(stderr, "error: missing symbol %s\n", name);
+   return fn != nullptr;
+}
+
+static bool load_core(const char* path, Core& core)
+{
+   core.handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+   if (!core.handle)
+   {
+      std::fprintf(stderr, "error: %s\n", dlerror());
+      return false;
+   }
+
+   bool ok = true;
+   ok &= load_symbol(core.handle, "retro_set_environment", core.set_environment);
+   ok &= load_symbol(core.handle, "retro_set_video_refresh", core.set_video_refresh);
+   ok &= load_symbol(core.handle, "retro_set_audio_sample", core.set_audio_sample);
+   ok &= load_symbol(core.handle, "retro_set_audio_sample_batch", core.set_audio_sample_batch);
+   ok &= load_symbol(core.handle, "retro_set_input_poll", core.set_input_poll);
+   ok &= load_symbol(core.handle, "retro_set_input_state", core.set_input_state);
+   ok &= load_symbol(core.handle, "retro_init", core.init);
+   ok &= load_symbol(core.handle, "retro_deinit", core.deinit);
+   ok &= load_symbol(core.handle, "retro_api_version", core.api_version);
+   ok &= load_symbol(core.handle, "retro_get_system_info", core.get_system_info);
+   ok &= load_symbol(core.handle, "retro_get_system_av_info", core.get_system_av_info);
+   ok &= load_symbol(core.handle, "retro_load_game", core.load_game);
+   ok &= load_symbol(core.handle, "retro_unload_game", core.unload_game);
+   ok &= load_symbol(core.handle, "retro_run", core.run);
+   return ok;
+}
+
+// ------------------------------------------------------------
+// Frontend state
+// ------------------------------------------------------------
+static bool               g_can_dupe       = true;
+static bool               g_sw_framebuffer = true;
+static retro_pixel_format g_pixel_format   = RETRO_PIXEL_FORMAT_0RGB1555;
+
+static std::vector<uint8_t> g_framebuffer; // Handed out via GET_CURRENT_SOFTWARE_FRAMEBUFFER
+static size_t               g_fb_pitch = 0;
+
+// Last non-dupe frame (for --dump). Like a frontend, only the pointer is kept:
+// a dupe means "show this again", so the core must leave it intact.
+static const uint8_t* g_last_frame  = nullptr;
+static size_t         g_last_pitch  = 0;
+static unsigned       g_last_width  = 0;
+static unsigned       g_last_height = 0;
+
+static uint64_t g_frames_presented = 0;
+static uint64_t g_frames_duped     = 0;
+static uint64_t g_frames_zero_copy = 0;
+static uint64_t g_audio_frames     = 0;
+
+static unsigned bytes_per_pixel(retro_pixel_format fmt)
+{
+   return fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2;
+}
+
+// ------------------------------------------------------------
+// Callbacks
+// ------------------------------------------------------------
+static void log_printf(retro_log_level level, const char* fmt, ...)
+{
+   static const char* const names[] = { "debug", "info", "warn", "error" };
+   std::fprintf(stderr, "[core %s] ", names[level < 4 ? level : 3]);
+
+   va_list args;
+   va_start(args, fmt);
+   std::vfprintf(stderr, fmt, args);
+   va_end(args);
+}
+
+static bool environment(unsigned cmd, void* data)
+{
+   switch (cmd)
+   {
+   case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+      g_pixel_format = *static_cast<const retro_pixel_format*>(data);
+      return true;
+
+   case RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME:
+      return true;
+
+   case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+      *static_cast<bool*>(data) = g_can_dupe;
+      return true;
+
+   case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+      static_cast<retro_log_callback*>(data)->log = log_printf;
+      return true;
+
+   case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER:
+   {
+      if (!g_sw_framebuffer)
+         return false;
+
+      retro_framebuffer* fb = static_cast<retro_framebuffer*>(data);
+      const size_t pitch = size_t(fb->width) * bytes_per_pixel(g_pixel_format);
+      if (g_framebuffer.size() < pitch * fb->height)
+         g_framebuffer.resize(pitch * fb->height);
+
+      g_fb_pitch = pitch;
+      fb->data = g_framebuffer.data();
+      fb->pitch = pitch;
+      fb->format = g_pixel_format;
+      fb->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+      return true;
+   }
+
+   default:
+      return false;
+   }
+}
+
+static void video_refresh(const void* data, unsigned width, unsigned height, size_t pitch)
+{
+   if (!data)
+   {
+      ++g_frames_duped;
+      return;
+   }
+
+   ++g_frames_presented;
+   if (!g_framebuffer.empty() && data == g_framebuffer.data())
+      ++g_frames_zero_copy;
+
+   g_last_frame  = static_cast<const uint8_t*>(data);
+   g_last_pitch  = pitch;
+   g_last_width  = width;
+   g_last_height = height;
+}
+
+static void audio_sample(int16_t /*left*/, int16_t /*right*/) { ++g_audio_frames; }
+static size_t audio_sample_batch(const int16_t* /*data*/, size_t frames) { g_audio_frames += frames; return frames; }
+static void input_poll(void) {}
+static int16_t input_state(unsigned /*port*/, unsigned /*device*/, unsigned /*index*/, unsigned /*id*/) { return 0; }
+
+// ------------------------------------------------------------
+// Reporting
+// ------------------------------------------------------------
+static bool dump_ppm(const char* path)
+{
+   if (!g_last_frame)
+      return false;
+
+   std::FILE* file = std::fopen(path, "wb");
+   if (!file)
+      return false;
+
+   std::fprintf(file, "P6\n%u %u\n255\n", g_last_width, g_last_height);
+   const unsigned bpp = bytes_per_pixel(g_pixel_format);
+   for (size_t i = 0; i < size_t(g_last_width) * g_last_height; ++i)
+   {
+      const uint8_t* pixel = g_last_frame + (i / g_last_width) * g_last_pitch + (i % g_last_width) * bpp;
+      uint8_t rgb[3];
+      if (bpp == 4)
+      {
+         uint32_t p;
+         std::memcpy(&p, pixel, 4);
+         rgb[0] = uint8_t(p >> 16); rgb[1] = uint8_t(p >> 8); rgb[2] = uint8_t(p);
+      }
+      else
+      {
+         uint16_t p;
+         std::memcpy(&p, pixel, 2);
+         if (g_pixel_format == RETRO_PIXEL_FORMAT_RGB565)
+         {
+            rgb[0] = uint8_t(((p >> 11) & 0x1F) * 255 / 31);
+            rgb[1] = uint8_t(((p >> 5) & 0x3F) * 255 / 63);
+         }
+         else
+         {
+            rgb[0] = uint8_t(((p >> 10) & 0x1F) * 255 / 31);
+            rgb[1] = uint8_t(((p >> 5) & 0x1F) * 255 / 31);
+         }
+         rgb[2] = uint8_t((p & 0x1F) * 255 / 31);
+      }
+      std::fwrite(rgb, 1, 3, file);
+   }
+   return std::fclose(file) == 0;
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+   // Nearest rank
+   const size_t rank = size_t(p / 100.0 * double(sorted.size()) + 0.5);
+   return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+static long peak_rss_kb()
+{
+   rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_maxrss; // Linux reports KiB
+}
+
+static void usage(const char* argv0)
+{
+   std::fprintf(stderr,
+                "usage: %s <core.so> [--frames N] [--warmup N] [--no-dupe]\n"
+                "       [--no-sw-framebuffer] [--dump frame.ppm]\n", argv0);
+}
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+int main(int argc, char** argv)
+{
+   if (argc < 2)
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   const char* core_path = argv[1];
+   const char* dump_path = nullptr;
+   unsigned frames = 600;
+   unsigned warmup = 60;
+
+   for (int i = 2; i < argc; ++i)
+   {
+      if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+         frames = unsigned(std::strtoul(argv[++i], nullptr, 10));
+      else if (!std::strcmp(argv[i], "--warmup") && i + 1 < argc)
+         warmup = unsigned(std::strtoul(argv[++i], nullptr, 10));
+      else if (!std::strcmp(argv[i], "--no-dupe"))
+         g_can_dupe = false;
+      else if (!std::strcmp(argv[i], "--no-sw-framebuffer"))
+         g_sw_framebuffer = false;
+      else if (!std::strcmp(argv[i], "--dump") && i + 1 < argc)
+         dump_path = argv[++i];
+      else
+      {
+         usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (frames == 0)
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   Core core;
+   if (!load_core(core_path, core))
+      return 1;
+
+   if (core.api_version() != RETRO_API_VERSION)
+   {
+      std::fprintf(stderr, "error: core API version %u, expected %u\n", core.api_version(), RETRO_API_VERSION);
+      return 1;
+   }
+
+   // Same call order as RetroArch
+   core.set_environment(environment);
+   core.init();
+   core.set_video_refresh(video_refresh);
+   core.set_audio_sample(audio_sample);
+   core.set_audio_sample_batch(audio_sample_batch);
+   core.set_input_poll(input_poll);
+   core.set_input_state(input_state);
+
+   retro_system_info info;
+   core.get_system_info(&info);
+
+   retro_game_info game = {};
+   if (!core.load_game(&game))
+   {
+      std::fprintf(stderr, "error: retro_load_game failed\n");
+      return 1;
+   }
+
+   retro_system_av_info av;
+   core.get_system_av_info(&av);
+
+   for (unsigned i = 0; i < warmup; ++i)
+      core.run();
+
+   g_frames_presented = g_frames_duped = g_frames_zero_copy = 0;
+
+   using clock = std::chrono::steady_clock;
+   std::vector<double> latency_us(frames);
+
+   const uint64_t allocations_before = g_heap_allocations.load(std::memory_order_relaxed);
+   const clock::time_point start = clock::now();
+   for (unsigned i = 0; i < frames; ++i)
+   {
+      const clock::time_point begin = clock::now();
+      core.run();
+      latency_us[i] = std::chrono::duration<double, std::micro>(clock::now() - begin).count();
+   }
+   const double total_s = std::chrono::duration<double>(clock::now() - start).count();
+   const uint64_t allocations = g_heap_allocations.load(std::memory_order_relaxed) - allocations_before;
+
+   std::sort(latency_us.begin(), latency_us.end());
+   double sum_us = 0.0;
+   for (double v : latency_us)
+      sum_us += v;
+
+   std::printf("core        %s %s\n", info.library_name, info.library_version);
+   std::printf("video       %ux%u @ %.2f fps, format %s\n", av.geometry.base_width, av.geometry.base_height,
+               av.timing.fps,
+               g_pixel_format == RETRO_PIXEL_FORMAT_XRGB8888 ? "XRGB8888" :
+               g_pixel_format == RETRO_PIXEL_FORMAT_RGB565 ? "RGB565" : "0RGB1555");
+   std::printf("frames      %u (+%u warmup), presented %llu, duped %llu, zero-copy %llu\n", frames, warmup,
+               (unsigned long long)g_frames_presented, (unsigned long long)g_frames_duped,
+               (unsigned long long)g_frames_zero_copy);
+   std::printf("throughput  %.1f frames/s\n", double(frames) / total_s);
+   std::printf("latency us  mean %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", sum_us / frames,
+               percentile(latency_us, 50), percentile(latency_us, 90), percentile(latency_us, 99),
+               latency_us.back());
+   std::printf("peak rss    %ld KiB\n", peak_rss_kb());
+   std::printf("heap allocs %llu (%.2f per frame)\n", (unsigned long long)allocations, double(allocations) / frames);
+
+   if (dump_path && !dump_ppm(dump_path))
+      std::fprintf(stderr, "warning: could not write %s\n", dump_path);
+
+   core.unload_game();
+   core.deinit();
+   dlclose(core.handle);
+   return 0;
+}
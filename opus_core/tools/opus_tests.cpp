@@ -0,0 +1,634 @@
+// opus_tests.cpp - behaviour tests for the Opus task scheduler and kernels
+//
+// Checks child ordering, modulo/offset gating, Graph mode dependency waves
+// and cycle refusal, queued Add/Remove and their cancellation, deferred
+// work budgeting, and pixel format conversion. Every check is an assert, so
+// the first failure aborts with its line; a clean run prints one line per
+// group and exits 0.
+//
+//   opus_tests
+
+// Checks stay live in Release builds
+#undef NDEBUG
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "opus_gfx.h"
+#include "opus_jobs.h"
+#include "opus_kernels.h"
+#include "opus_profiler.h"
+#include "opus_tasks.h"
+
+using opus::gfx::Color;
+using opus::gfx::PixelFormat;
+using opus::gfx::Surface;
+using opus::tasks::DeferrableTask;
+using opus::tasks::DeferredTaskContainer;
+using opus::tasks::ExecutionMode;
+using opus::tasks::Task;
+using opus::tasks::TaskContainer;
+
+// ------------------------------------------------------------
+// Fixtures
+// ------------------------------------------------------------
+// Children append their id to a shared log, so a test can read back which
+// ran and in what order. Jobs may run them concurrently, hence the lock.
+static std::mutex g_log_mutex;
+static std::vector<int> g_log;
+
+static void clear_log()
+{
+   std::lock_guard<std::mutex> lock(g_log_mutex);
+   g_log.clear();
+}
+
+static std::vector<int> take_log()
+{
+   std::lock_guard<std::mutex> lock(g_log_mutex);
+   std::vector<int> log;
+   log.swap(g_log);
+   return log;
+}
+
+static size_t position(const std::vector<int>& log, int id)
+{
+   for (size_t i = 0; i < log.size(); ++i)
+   {
+      if (log[i] == id)
+         return i;
+   }
+   return log.size();
+}
+
+class LogTask : public Task
+{
+public:
+   LogTask(int id, uint32_t modulo = 1, uint32_t offset = 0, bool internal = false)
+      : Task(modulo, offset, true, internal), m_id(id)
+   {
+   }
+
+   std::vector<uint64_t> counts; // Count each run was given
+
+protected:
+   void OnUpdate(uint64_t count) override
+   {
+      counts.push_back(count);
+      std::lock_guard<std::mutex> lock(g_log_mutex);
+      g_log.push_back(m_id);
+   }
+
+private:
+   int m_id;
+};
+
+class SpinTask : public DeferrableTask
+{
+public:
+   SpinTask(int id, uint32_t priority, uint64_t spin_ns)
+      : DeferrableTask(priority, 1, 0, true), m_id(id), m_spin_ns(spin_ns)
+   {
+   }
+
+   int runs = 0;
+
+protected:
+   void OnUpdate(uint64_t) override
+   {
+      ++runs;
+      const uint64_t end = opus::profiler::NowNs() + m_spin_ns;
+      while (opus::profiler::NowNs() < end)
+      {
+      }
+      std::lock_guard<std::mutex> lock(g_log_mutex);
+      g_log.push_back(m_id);
+   }
+
+private:
+   int m_id;
+   uint64_t m_spin_ns;
+};
+
+// ------------------------------------------------------------
+// Ordering
+// ------------------------------------------------------------
+static void test_ordering(opus::jobs::JobPool& pool)
+{
+   // Serial: insertion order, every tick
+   {
+      TaskContainer root;
+      root.Enable();
+      std::vector<std::unique_ptr<LogTask>> tasks;
+      for (int i = 0; i < 8; ++i)
+      {
+         tasks.push_back(std::make_unique<LogTask>(i));
+         assert(root.AddTask(*tasks.back()));
+      }
+
+      clear_log();
+      root.Update(0);
+      assert((take_log() == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+
+      // A removed child leaves the others in order; re-adding goes to the back
+      root.RemoveTask(*tasks[2]);
+      root.Update(1);
+      assert((take_log() == std::vector<int>{0, 1, 3, 4, 5, 6, 7}));
+      root.AddTask(*tasks[2]);
+      root.Update(2);
+      assert((take_log() == std::vector<int>{0, 1, 3, 4, 5, 6, 7, 2}));
+   }
+
+   // Parallel: a child that is not independent stays a barrier between the
+   // runs of independent children on either side of it
+   {
+      TaskContainer root;
+      root.Enable();
+      root.SetJobPool(&pool);
+      assert(root.SetExecutionMode(ExecutionMode::Parallel));
+      std::vector<std::unique_ptr<LogTask>> tasks;
+      for (int i = 0; i < 40; ++i)
+      {
+         tasks.push_back(std::make_unique<LogTask>(i));
+         tasks.back()->SetIndependent(i % 10 != 0);
+         root.AddTask(*tasks.back());
+      }
+
+      for (uint64_t frame = 0; frame < 20; ++frame)
+      {
+         clear_log();
+         root.Update(frame);
+         const std::vector<int> log = take_log();
+         assert(log.size() == tasks.size());
+         for (int barrier = 10; barrier < 40; barrier += 10)
+         {
+            for (int i = 0; i < 40; ++i)
+            {
+               if (i < barrier)
+                  assert(position(log, i) < position(log, barrier));
+               else if (i > barrier)
+                  assert(position(log, i) > position(log, barrier));
+            }
+         }
+      }
+   }
+
+   std::printf("  ordering: ok\n");
+}
+
+// ------------------------------------------------------------
+// Modulo / offset gating
+// ------------------------------------------------------------
+static void test_gating()
+{
+   TaskContainer root;
+   root.Enable();
+   LogTask every(0);
+   LogTask third(1, 3, 0);
+   LogTask third_late(2, 3, 1); // Due when (count + 1) % 3 == 0
+   LogTask fifth(3, 5, 2);
+   LogTask own(4, 1, 0, true);  // Counts its own runs
+   root.AddTask(every);
+   root.AddTask(third);
+   root.AddTask(third_late);
+   root.AddTask(fifth);
+   root.AddTask(own);
+
+   for (uint64_t count = 100; count < 130; ++count)
+      root.Update(count);
+
+   assert(every.counts.size() == 30);
+   for (uint64_t count : third.counts)
+      assert(count % 3 == 0);
+   for (uint64_t count : third_late.counts)
+      assert((count + 1) % 3 == 0);
+   for (uint64_t count : fifth.counts)
+      assert((count + 2) % 5 == 0);
+   assert(third.counts.size() == 10);
+   assert(third_late.counts.size() == 10);
+   assert(fifth.counts.size() == 6);
+   assert(third.counts.front() == 102 && third_late.counts.front() == 101 && fifth.counts.front() == 103);
+
+   // The internal child ignores the parent count
+   assert(own.counts.size() == 30);
+   for (uint64_t i = 0; i < own.counts.size(); ++i)
+      assert(own.counts[i] == i);
+
+   // Disabled children are skipped until enabled again, then gated as before
+   third.Disable();
+   for (uint64_t count = 130; count < 136; ++count)
+      root.Update(count);
+   assert(third.counts.size() == 10);
+   third.Enable();
+   for (uint64_t count = 136; count < 142; ++count)
+      root.Update(count);
+   assert(third.counts.size() == 12 && third.counts.back() == 141);
+
+   // A disabled container runs none of its children
+   root.Disable();
+   clear_log();
+   root.Update(142);
+   assert(take_log().empty());
+
+   std::printf("  gating: ok\n");
+}
+
+// ------------------------------------------------------------
+// Graph waves and cycles
+// ------------------------------------------------------------
+static void test_graph(opus::jobs::JobPool& pool)
+{
+   //   0 -> 1 -> 3
+   //   0 -> 2 -> 3 -> 4, 5 unconstrained
+   TaskContainer root;
+   root.Enable();
+   root.SetJobPool(&pool);
+   std::vector<std::unique_ptr<LogTask>> tasks;
+   for (int i = 0; i < 6; ++i)
+   {
+      tasks.push_back(std::make_unique<LogTask>(i));
+      root.AddTask(*tasks.back());
+   }
+   assert(tasks[1]->DependsOn(*tasks[0]));
+   assert(tasks[2]->DependsOn(*tasks[0]));
+   assert(tasks[3]->DependsOn(*tasks[1]));
+   assert(tasks[3]->DependsOn(*tasks[2]));
+   assert(tasks[4]->DependsOn(*tasks[3]));
+
+   // Edges that would close a cycle are refused and leave the graph as it was
+   assert(!tasks[0]->DependsOn(*tasks[4]));
+   assert(!tasks[1]->DependsOn(*tasks[3]));
+   assert(!tasks[5]->DependsOn(*tasks[5]));
+   assert(tasks[0]->Dependencies().empty());
+   assert(tasks[5]->Dependencies().empty());
+
+   assert(root.SetExecutionMode(ExecutionMode::Graph));
+   assert(root.IsGraphValid());
+   assert(root.CycleTasks().empty());
+
+   const auto check_waves = [&]()
+   {
+      const std::vector<int> log = take_log();
+      assert(log.size() == tasks.size());
+      assert(position(log, 0) < position(log, 1));
+      assert(position(log, 0) < position(log, 2));
+      assert(position(log, 1) < position(log, 3));
+      assert(position(log, 2) < position(log, 3));
+      assert(position(log, 3) < position(log, 4));
+   };
+
+   for (uint64_t frame = 0; frame < 20; ++frame)
+   {
+      clear_log();
+      root.Update(frame);
+      check_waves();
+   }
+
+   // Edges belong to the tasks: they survive a Remove and re-Add
+   root.RemoveTask(*tasks[0]);
+   clear_log();
+   root.Update(20);
+   const std::vector<int> without = take_log();
+   assert(without.size() == 5 && position(without, 0) == without.size());
+   root.AddTask(*tasks[0]);
+   clear_log();
+   root.Update(21);
+   check_waves();
+
+   // Dropping edges lets a task move to the first wave, and a former
+   // dependent may now run first
+   tasks[4]->ClearDependencies();
+   assert(tasks[0]->DependsOn(*tasks[4]));
+   assert(root.BuildGraph());
+   clear_log();
+   root.Update(22);
+   const std::vector<int> log = take_log();
+   assert(position(log, 4) < position(log, 0));
+   assert(position(log, 0) < position(log, 1));
+
+   std::printf("  graph: ok\n");
+}
+
+// ------------------------------------------------------------
+// Queued Add / Remove
+// ------------------------------------------------------------
+class RemovingTask : public Task
+{
+public:
+   RemovingTask(TaskContainer& parent, Task& victim)
+      : Task(1, 0, true, false), m_parent(parent), m_victim(victim)
+   {
+   }
+
+protected:
+   void OnUpdate(uint64_t) override { m_parent.RemoveTask(m_victim); }
+
+private:
+   TaskContainer& m_parent;
+   Task& m_victim;
+};
+
+class CountingDrawable : public opus::gfx::Drawable
+{
+public:
+   int draws = 0;
+
+   opus::gfx::Rect GetBounds() const override { return opus::gfx::Rect{0, 0, 4, 4}; }
+   void Draw(Surface&) override { ++draws; }
+};
+
+static void test_add_remove()
+{
+   // TaskContainer
+   {
+      TaskContainer root;
+      root.Enable();
+      LogTask a(0);
+      assert(root.AddTask(a));
+      root.Update(0);
+      assert(a.counts.size() == 1);
+      assert(a.GetParent() == &root);
+
+      // Remove then Add before the next update: the Add cancels the Remove
+      root.RemoveTask(a);
+      assert(root.AddTask(a));
+      root.Update(1);
+      assert(a.counts.size() == 2);
+      assert(!root.AddTask(a)); // Already a child
+
+      // Add then Remove then Add: still a child, once
+      root.RemoveTask(a);
+      root.Update(2);
+      assert(a.counts.size() == 2 && a.GetParent() == nullptr);
+      root.AddTask(a);
+      root.RemoveTask(a);
+      root.AddTask(a);
+      root.Update(3);
+      assert(a.counts.size() == 3);
+
+      // Remove, Add, Remove: gone
+      root.RemoveTask(a);
+      root.AddTask(a);
+      root.RemoveTask(a);
+      root.Update(4);
+      assert(a.counts.size() == 3 && a.GetParent() == nullptr);
+
+      // A task belongs to one container at a time
+      TaskContainer other;
+      assert(root.AddTask(a));
+      assert(!other.AddTask(a));
+      root.RemoveTask(a);
+      root.ApplyPending();
+      assert(other.AddTask(a));
+      other.RemoveTask(a);
+      other.ApplyPending();
+
+      // Removed by a sibling earlier in the same tick: the rest of the pass
+      // still sees it, the next one does not
+      LogTask b(1);
+      RemovingTask remover(root, b);
+      root.AddTask(remover);
+      root.AddTask(b);
+      root.Update(5);
+      root.Update(6);
+      assert(b.counts.size() == 1 && b.GetParent() == nullptr);
+      root.RemoveTask(remover);
+      root.ApplyPending();
+   }
+
+   // DeferredTaskContainer
+   {
+      DeferredTaskContainer queue;
+      queue.Enable();
+      SpinTask a(0, 1, 0);
+      assert(queue.AddTask(a));
+      queue.RemoveTask(a);
+      assert(queue.AddTask(a));
+      queue.Update(0);
+      assert(a.runs == 1 && a.GetQueue() == &queue);
+
+      // A task with a Remove queued is not run, even if it was already pending
+      queue.RemoveTask(a);
+      queue.Update(1);
+      assert(a.runs == 1 && a.GetQueue() == nullptr && !a.IsPending());
+
+      // Destroying a queued task drops it from the queue
+      {
+         SpinTask temp(1, 1, 0);
+         queue.AddTask(temp);
+         queue.Update(2);
+         assert(temp.runs == 1);
+      }
+      queue.Update(3);
+      assert(queue.NumPending() == 0);
+   }
+
+   // DrawableTask
+   {
+      Surface target(16, 16, PixelFormat::XRGB8888);
+      opus::gfx::DrawableTask layer;
+      layer.SetTarget(target);
+      layer.Enable();
+      CountingDrawable sprite;
+      assert(layer.AddDrawable(sprite));
+      layer.Update(0);
+      assert(sprite.draws == 1);
+
+      layer.RemoveDrawable(sprite);
+      assert(layer.AddDrawable(sprite));
+      sprite.MarkDirty();
+      layer.Update(1);
+      assert(sprite.draws == 2);
+      assert(!layer.AddDrawable(sprite));
+
+      // Clear drops every drawable; they can be added again at once
+      layer.Clear();
+      assert(layer.AddDrawable(sprite));
+      sprite.MarkDirty();
+      layer.Update(2);
+      assert(sprite.draws == 3);
+
+      layer.Clear();
+      layer.Update(3);
+      sprite.MarkDirty();
+      layer.Update(4);
+      assert(sprite.draws == 3);
+   }
+
+   std::printf("  add/remove: ok\n");
+}
+
+// ------------------------------------------------------------
+// Deferred budgeting
+// ------------------------------------------------------------
+static void test_deferred()
+{
+   DeferredTaskContainer queue;
+   queue.Enable();
+   SpinTask low(0, 1, 0);
+   SpinTask high(1, 9, 0);
+   SpinTask mid(2, 5, 0);
+   queue.AddTask(low);
+   queue.AddTask(high);
+   queue.AddTask(mid);
+
+   // No deadline: everything due runs, highest priority first
+   clear_log();
+   queue.Update(0);
+   assert((take_log() == std::vector<int>{1, 2, 0}));
+   assert(queue.NumPending() == 0);
+
+   // Work that would overrun the deadline waits; cheaper work behind it runs
+   SpinTask costly(3, 20, 4000000);
+   queue.AddTask(costly);
+   queue.Update(1); // Measures it
+   assert(costly.runs == 1 && costly.CostNs() >= 4000000);
+
+   clear_log();
+   queue.SetDeadline(opus::profiler::NowNs() + 1000000);
+   queue.Update(2);
+   assert(costly.runs == 1 && costly.IsPending());
+   assert(queue.NumPending() == 1);
+   assert(low.runs == 3 && mid.runs == 3 && high.runs == 3);
+
+   // It keeps its place at the front and runs once there is room
+   queue.SetDeadline(0);
+   clear_log();
+   queue.Update(3);
+   const std::vector<int> log = take_log();
+   assert(costly.runs == 2 && !costly.IsPending());
+   assert(!log.empty() && log.front() == 3);
+   assert(queue.NumPending() == 0);
+
+   // Skipped work is tried again within a few ticks even when it never fits
+   for (uint64_t count = 4; count < 40 && costly.runs == 2; ++count)
+   {
+      queue.SetDeadline(opus::profiler::NowNs() + 1000000);
+      queue.Update(count);
+   }
+   assert(costly.runs == 3);
+
+   std::printf("  deferred: ok\n");
+}
+
+// ------------------------------------------------------------
+// Pixel formats
+// ------------------------------------------------------------
+static void test_pixel_formats()
+{
+   namespace kernels = opus::gfx::kernels;
+   namespace pixel = opus::gfx::pixel;
+
+   const Color colors[] = {
+      Color::FromRGB(0, 0, 0), Color::FromRGB(255, 255, 255), Color::FromRGB(255, 0, 0),
+      Color::FromRGB(0, 255, 0), Color::FromRGB(0, 0, 255), Color::FromRGB(0x84, 0x41, 0xC6),
+   };
+
+   // Packing round-trips the bits RGB565 keeps
+   for (const Color& c : colors)
+   {
+      const uint16_t packed = c.Pack<pixel::RGB565>();
+      const uint32_t back = pixel::RGB565::ToXRGB(packed);
+      assert(((back >> 19) & 0x1F) == uint32_t(c.GetR() >> 3));
+      assert(((back >> 10) & 0x3F) == uint32_t(c.GetG() >> 2));
+      assert(((back >> 3) & 0x1F) == uint32_t(c.GetB() >> 3));
+      assert(pixel::RGB565::FromXRGB(back) == packed);
+   }
+   assert(Color::FromRGB(255, 0, 0).Pack<pixel::RGB565>() == 0xF800);
+   assert(Color::FromRGB(0, 255, 0).Pack<pixel::RGB565>() == 0x07E0);
+   assert(Color::FromRGB(0, 0, 255).Pack<pixel::RGB565>() == 0x001F);
+
+   // Convert and Expand on every instruction set, at widths that leave
+   // vector tails
+   const kernels::Isa initial = kernels::GetIsa();
+   for (kernels::Isa isa : {kernels::Isa::Scalar, kernels::Isa::SSE2, kernels::Isa::AVX2})
+   {
+      if (!kernels::SetIsa(isa))
+         continue;
+
+      for (uint32_t width : {1u, 7u, 16u, 33u})
+      {
+         const uint32_t height = 3;
+         const size_t num_colors = sizeof(colors) / sizeof(colors[0]);
+
+         Surface xrgb(width, height, PixelFormat::XRGB8888);
+         for (uint32_t y = 0; y < height; ++y)
+         {
+            for (uint32_t x = 0; x < width; ++x)
+               xrgb.GetRowAs<uint32_t>(y)[x] = colors[(x + y) % num_colors].GetXRGB();
+         }
+
+         // XRGB8888 -> RGB565 -> XRGB8888
+         Surface rgb565(width, height, PixelFormat::RGB565);
+         Surface back(width, height, PixelFormat::XRGB8888);
+         assert(kernels::Convert(xrgb, rgb565));
+         assert(kernels::Convert(rgb565, back));
+         for (uint32_t y = 0; y < height; ++y)
+         {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+               const Color& c = colors[(x + y) % num_colors];
+               assert(rgb565.GetRowAs<uint16_t>(y)[x] == c.Pack<pixel::RGB565>());
+               assert(pixel::XRGB8888::ToXRGB(back.GetRowAs<uint32_t>(y)[x]) ==
+                      pixel::RGB565::ToXRGB(c.Pack<pixel::RGB565>()));
+            }
+         }
+
+         // Conversion stays inside the destination's clip rect
+         Surface clipped(width, height, PixelFormat::RGB565);
+         clipped.Fill(Color::FromRGB(0, 0, 255));
+         clipped.SetClip(opus::gfx::Rect{0, 1, int32_t(width), 1});
+         assert(kernels::Convert(xrgb, clipped));
+         assert(clipped.GetRowAs<uint16_t>(0)[0] == 0x001F && clipped.GetRowAs<uint16_t>(2)[0] == 0x001F);
+         assert(clipped.GetRowAs<uint16_t>(1)[0] == colors[1].Pack<pixel::RGB565>());
+
+         // Indexed8 through a palette into both direct formats
+         opus::gfx::Palette palette;
+         for (size_t i = 0; i < num_colors; ++i)
+            palette.SetColor(uint8_t(i), colors[i]);
+         Surface indexed(width, height, PixelFormat::Indexed8);
+         for (uint32_t y = 0; y < height; ++y)
+         {
+            for (uint32_t x = 0; x < width; ++x)
+               indexed.GetRowAs<uint8_t>(y)[x] = uint8_t((x * 5 + y) % num_colors);
+         }
+         assert(!kernels::Convert(indexed, xrgb));
+         assert(kernels::Expand(indexed, xrgb, palette));
+         assert(kernels::Expand(indexed, rgb565, palette));
+         for (uint32_t y = 0; y < height; ++y)
+         {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+               const Color& c = colors[(x * 5 + y) % num_colors];
+               assert(pixel::XRGB8888::ToXRGB(xrgb.GetRowAs<uint32_t>(y)[x]) == c.GetRGB());
+               assert(rgb565.GetRowAs<uint16_t>(y)[x] == c.Pack<pixel::RGB565>());
+            }
+         }
+      }
+   }
+   kernels::SetIsa(initial);
+
+   std::printf("  pixel formats: ok\n");
+}
+
+// ------------------------------------------------------------
+// main
+// ------------------------------------------------------------
+int main()
+{
+   opus::jobs::JobPool pool(3);
+
+   std::printf("[Opus tests]\n");
+   test_ordering(pool);
+   test_gating();
+   test_graph(pool);
+   test_add_remove();
+   test_deferred();
+   test_pixel_formats();
+   std::printf("All passed\n");
+   return 0;
+}